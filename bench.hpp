@@ -0,0 +1,370 @@
+/* Common driver for the table-style benchmarks: size ranges, repetitions
+ * and text/CSV/JSON output with environment metadata.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef BENCH_HPP_2B9E6C1A_CB3F_11F1_9D4E_02FC00000001
+#define BENCH_HPP_2B9E6C1A_CB3F_11F1_9D4E_02FC00000001
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/version.hpp>
+
+#if defined(__unix__)||defined(__APPLE__)
+#include <sys/utsname.h>
+#endif
+
+/* A benchmark program creates a session from its command line and feeds it
+ * tables: a title, one name per column and one runner per column returning
+ * the time per element in seconds for a given size. Recognized options:
+ *
+ *   --n0=N --n1=N --dn=N --fdn=X  sizes n0, n0+dn, ... with dn*=fdn each step
+ *   --sizes=N,N,...               explicit list of sizes
+ *   --repetitions=N               runs per size and column (default 1)
+ *   --threads=N                   maximum thread count for concurrent tables
+ *                                 (default std::thread::hardware_concurrency)
+ *   --format=text|csv|json        output format (default text)
+ *   --mode=timing|latency         tables of average times (default) or,
+ *                                 where supported, latency percentiles
+ *
+ * Text output is the semicolon-separated layout used so far, with the mean
+ * over repetitions; CSV has one line per measurement and JSON groups all
+ * repetitions. Values are scaled by 10E6 as in the text tables unless the
+ * table gives another scale (e.g. 1 for throughputs). Rows are labelled
+ * with the size requested unless the table provides a row_size function
+ * giving the effective size (e.g. the number of distinct elements actually
+ * inserted), which is then used in all formats.
+ */
+
+namespace bench{
+
+typedef std::function<double(unsigned int)>       runner;
+typedef std::function<unsigned int(unsigned int)> row_size;
+
+class size_range
+{
+public:
+  size_range(unsigned int n0,unsigned int n1,unsigned int dn,double fdn):
+    n0(n0),n1(n1),dn(dn),fdn(fdn){}
+  explicit size_range(const std::vector<unsigned int>& l):
+    n0(0),n1(0),dn(0),fdn(1.0),list(l){}
+
+  std::vector<unsigned int> sizes()const
+  {
+    if(!list.empty())return list;
+    std::vector<unsigned int> res;
+    for(unsigned int n=n0,d=dn;n<=n1;n+=d,d=(unsigned int)(d*fdn)){
+      res.push_back(n);
+      if(!d)break;
+    }
+    return res;
+  }
+
+  unsigned int              n0,n1,dn;
+  double                    fdn;
+  std::vector<unsigned int> list;
+};
+
+enum output_format{text,csv,json};
+enum run_mode{timing_mode,latency_mode};
+
+struct options
+{
+  size_range    range;
+  unsigned int  repetitions;
+  unsigned int  threads;
+  output_format format;
+  run_mode      mode;
+};
+
+inline options parse_options(
+  int argc,char* argv[],const size_range& default_range)
+{
+  unsigned int hc=std::thread::hardware_concurrency();
+  options      res={default_range,1,hc?hc:1,text,timing_mode};
+  for(int i=1;i<argc;++i){
+    std::string arg=argv[i];
+    std::string::size_type eq=arg.find('=');
+    if(arg.compare(0,2,"--")!=0||eq==std::string::npos){
+      throw std::invalid_argument("bad option: "+arg);
+    }
+    std::string key=arg.substr(2,eq-2),value=arg.substr(eq+1);
+    if(key=="n0"||key=="n1"||key=="dn"||key=="fdn"){
+      res.range.list.clear();
+      if(key=="n0")res.range.n0=(unsigned int)std::stoul(value);
+      else if(key=="n1")res.range.n1=(unsigned int)std::stoul(value);
+      else if(key=="dn")res.range.dn=(unsigned int)std::stoul(value);
+      else res.range.fdn=std::stod(value);
+    }
+    else if(key=="sizes"){
+      res.range.list.clear();
+      std::istringstream is(value);
+      for(std::string n;std::getline(is,n,',');){
+        res.range.list.push_back((unsigned int)std::stoul(n));
+      }
+    }
+    else if(key=="repetitions"){
+      res.repetitions=(unsigned int)std::stoul(value);
+      if(!res.repetitions)throw std::invalid_argument("bad option: "+arg);
+    }
+    else if(key=="threads"){
+      res.threads=(unsigned int)std::stoul(value);
+      if(!res.threads)throw std::invalid_argument("bad option: "+arg);
+    }
+    else if(key=="format"){
+      if(value=="text")res.format=text;
+      else if(value=="csv")res.format=csv;
+      else if(value=="json")res.format=json;
+      else throw std::invalid_argument("bad option: "+arg);
+    }
+    else if(key=="mode"){
+      if(value=="timing")res.mode=timing_mode;
+      else if(value=="latency")res.mode=latency_mode;
+      else throw std::invalid_argument("bad option: "+arg);
+    }
+    else throw std::invalid_argument("bad option: "+arg);
+  }
+  return res;
+}
+
+/* 1, 2, 4, ... up to the maximum thread count, which is always included */
+
+inline std::vector<unsigned int> thread_counts(const options& opts)
+{
+  std::vector<unsigned int> res;
+  for(unsigned int t=1;t<opts.threads;t*=2)res.push_back(t);
+  res.push_back(opts.threads);
+  return res;
+}
+
+inline std::string thread_label(unsigned int t)
+{
+  return std::to_string(t)+(t==1?" thread":" threads");
+}
+
+/* Threads created while timing is paused wait at the gate, which is opened
+ * once timing resumes, so that thread creation is not measured.
+ */
+
+class start_gate
+{
+public:
+  start_gate():opened(false){}
+
+  void wait()const
+  {
+    while(!opened.load(std::memory_order_acquire))std::this_thread::yield();
+  }
+
+  void open(){opened.store(true,std::memory_order_release);}
+
+private:
+  std::atomic<bool> opened;
+};
+
+inline std::string json_string(const std::string& str)
+{
+  std::string res="\"";
+  for(char c:str){
+    switch(c){
+      case '"': res+="\\\"";break;
+      case '\\':res+="\\\\";break;
+      case '\n':res+="\\n";break;
+      case '\t':res+="\\t";break;
+      default:  res+=c;
+    }
+  }
+  return res+"\"";
+}
+
+inline std::string csv_string(const std::string& str)
+{
+  std::string res="\"";
+  for(char c:str){
+    if(c=='"')res+='"';
+    res+=c;
+  }
+  return res+"\"";
+}
+
+/* name/value pairs describing the build and the machine */
+
+inline std::vector<std::pair<std::string,std::string>> environment()
+{
+  std::vector<std::pair<std::string,std::string>> res;
+  auto add=[&](const std::string& name,const std::string& value){
+    res.push_back(std::make_pair(name,value));
+  };
+
+  char        buf[32];
+  std::time_t t=std::time(0);
+  std::strftime(buf,sizeof(buf),"%Y-%m-%dT%H:%M:%SZ",std::gmtime(&t));
+  add("timestamp",buf);
+#if defined(__clang__)
+  add("compiler","clang "+std::string(__clang_version__));
+#elif defined(__GNUC__)
+  add("compiler","gcc "+std::string(__VERSION__));
+#elif defined(_MSC_VER)
+  add("compiler","msvc "+std::to_string(_MSC_FULL_VER));
+#else
+  add("compiler","unknown");
+#endif
+  add("cplusplus",std::to_string(__cplusplus));
+#if defined(NDEBUG)
+  add("ndebug","1");
+#else
+  add("ndebug","0");
+#endif
+  add("boost",BOOST_LIB_VERSION);
+  add("hardware_concurrency",
+    std::to_string(std::thread::hardware_concurrency()));
+#if defined(__unix__)||defined(__APPLE__)
+  struct utsname u;
+  if(uname(&u)==0){
+    add("os",std::string(u.sysname)+" "+u.release);
+    add("machine",u.machine);
+    add("hostname",u.nodename);
+  }
+#endif
+  return res;
+}
+
+class session
+{
+public:
+  session(
+    const char* name,int argc,char* argv[],const size_range& default_range,
+    std::ostream& os=std::cout):
+    name(name),opts(parse_options(argc,argv,default_range)),
+    env(environment()),os(os)
+  {
+    if(opts.format==csv){
+      os<<"# benchmark: "<<name<<"\n";
+      for(const auto& p:env)os<<"# "<<p.first<<": "<<p.second<<"\n";
+      os<<"benchmark,table,column,size,repetition,value"<<std::endl;
+    }
+  }
+
+  ~session()
+  {
+    if(opts.format==json)write_json();
+  }
+
+  const options& get_options()const{return opts;}
+
+  void run(
+    const std::string& title,const std::vector<std::string>& names,
+    const std::vector<runner>& runners,double scale=10E6,
+    const row_size& size=row_size())
+  {
+    if(names.size()!=runners.size()){
+      throw std::invalid_argument("names and runners do not match");
+    }
+
+    tables.push_back(table{title,names,scale,{}});
+    table& tb=tables.back();
+    if(opts.format==text){
+      os<<title<<":"<<std::endl;
+      for(std::size_t i=0;i<names.size();++i){
+        os<<(i?";":"")<<names[i];
+      }
+      os<<std::endl;
+    }
+
+    for(unsigned int n:opts.range.sizes()){
+      unsigned int label=size?size(n):n;
+      tb.rows.push_back(row{label,{}});
+      row& r=tb.rows.back();
+      if(opts.format==text)os<<label;
+      for(std::size_t i=0;i<runners.size();++i){
+        std::vector<double> values;
+        double              sum=0.0;
+        for(unsigned int rep=0;rep<opts.repetitions;++rep){
+          double v=runners[i](n)*scale;
+          values.push_back(v);
+          sum+=v;
+          if(opts.format==csv){
+            os<<csv_string(name)<<","<<csv_string(title)<<","<<
+              csv_string(names[i])<<","<<label<<","<<rep<<","<<v<<std::endl;
+          }
+        }
+        if(opts.format==text)os<<";"<<sum/values.size();
+        r.values.push_back(values);
+      }
+      if(opts.format==text)os<<std::endl;
+    }
+  }
+
+private:
+  struct row
+  {
+    unsigned int                     n;
+    std::vector<std::vector<double>> values;
+  };
+
+  struct table
+  {
+    std::string              title;
+    std::vector<std::string> names;
+    double                   scale;
+    std::vector<row>         rows;
+  };
+
+  void write_json()
+  {
+    os<<"{\n  \"benchmark\": "<<json_string(name)<<",\n";
+    os<<"  \"environment\": {";
+    for(std::size_t i=0;i<env.size();++i){
+      os<<(i?",":"")<<"\n    "<<json_string(env[i].first)<<": "<<
+        json_string(env[i].second);
+    }
+    os<<"\n  },\n";
+    os<<"  \"repetitions\": "<<opts.repetitions<<",\n";
+    os<<"  \"tables\": [";
+    for(std::size_t t=0;t<tables.size();++t){
+      const table& tb=tables[t];
+      os<<(t?",":"")<<"\n    {\n      \"title\": "<<json_string(tb.title)<<
+        ",\n      \"scale\": "<<tb.scale<<",\n      \"columns\": [";
+      for(std::size_t i=0;i<tb.names.size();++i){
+        os<<(i?", ":"")<<json_string(tb.names[i]);
+      }
+      os<<"],\n      \"rows\": [";
+      for(std::size_t j=0;j<tb.rows.size();++j){
+        const row& r=tb.rows[j];
+        os<<(j?",":"")<<"\n        {\"size\": "<<r.n<<", \"values\": [";
+        for(std::size_t i=0;i<r.values.size();++i){
+          os<<(i?", ":"")<<"[";
+          for(std::size_t k=0;k<r.values[i].size();++k){
+            os<<(k?", ":"")<<r.values[i][k];
+          }
+          os<<"]";
+        }
+        os<<"]}";
+      }
+      os<<"\n      ]\n    }";
+    }
+    os<<"\n  ]\n}"<<std::endl;
+  }
+
+  std::string                                     name;
+  options                                         opts;
+  std::vector<std::pair<std::string,std::string>> env;
+  std::ostream&                                   os;
+  std::vector<table>                              tables;
+};
+
+} //namespace bench
+
+#endif
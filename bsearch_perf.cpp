@@ -1,5 +1,8 @@
 /* Measuring performance of binary search algorithms with and without optimized
  * lexicographical comparison.
+ * Requires C++14 (heterogeneous std::set::lower_bound in profile_containers),
+ * e.g.
+ *   g++ -std=c++14 -O3 bsearch_perf.cpp
  *
  * Copyright 2014 Joaquin M Lopez Munoz.
  * Distributed under the Boost Software License, Version 1.0.
@@ -55,7 +58,10 @@ void resume_timing()
 
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 template<typename Comp,typename T>
 struct comp_binder
@@ -176,6 +182,106 @@ struct comp_binder<prefix_less<T>,T>
   typename T::size_type      x_size,pref_left,pref_right;
 };
 
+/* Same as prefix_less, but for std::basic_string with std::char_traits
+ * (where equality is bytewise) the first mismatch past the known shared
+ * prefix is located 16 (SSE2) or 32 (AVX2) bytes at a time. Other types
+ * fall back to prefix_less.
+ */
+
+template<typename T>
+struct simd_prefix_less:std::less<T>
+{
+};
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* first index in [0,n) where a and b differ, n if none */
+
+template<typename CharT>
+std::size_t mismatch_index(const CharT* a,const CharT* b,std::size_t n)
+{
+  std::size_t i=0;
+#if defined(__SSE2__)
+  const char* pa=reinterpret_cast<const char*>(a);
+  const char* pb=reinterpret_cast<const char*>(b);
+  std::size_t bytes=n*sizeof(CharT);
+#if defined(__AVX2__)
+  for(;i+32<=bytes;i+=32){
+    unsigned int mask=~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa+i)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb+i))));
+    if(mask)return (i+__builtin_ctz(mask))/sizeof(CharT);
+  }
+#endif
+  for(;i+16<=bytes;i+=16){
+    unsigned int mask=0xFFFFu&~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa+i)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb+i))));
+    if(mask)return (i+__builtin_ctz(mask))/sizeof(CharT);
+  }
+  i/=sizeof(CharT);
+#endif
+  for(;i<n;++i)if(!std::char_traits<CharT>::eq(a[i],b[i]))return i;
+  return n;
+}
+
+template<typename T>
+struct comp_binder<simd_prefix_less<T>,T>:comp_binder<prefix_less<T>,T>
+{
+  comp_binder(simd_prefix_less<T>,const T& x):
+    comp_binder<prefix_less<T>,T>(prefix_less<T>(),x){}
+};
+
+template<typename CharT,typename Allocator>
+struct comp_binder<
+  simd_prefix_less<std::basic_string<CharT,std::char_traits<CharT>,Allocator>>,
+  std::basic_string<CharT,std::char_traits<CharT>,Allocator>
+>
+{
+  typedef std::basic_string<CharT,std::char_traits<CharT>,Allocator> string;
+  typedef typename string::size_type                                 size_type;
+  typedef std::char_traits<CharT>                                    traits;
+
+  comp_binder(simd_prefix_less<string> cmp,const string& x):
+    cmp(cmp),x(x),x_data(x.data()),x_size(x.size()),
+    pref_left(0),pref_right(0)
+  {}
+
+  template<typename Q> bool less(const Q& y){return cmp(y,x);}
+  template<typename Q> bool greater(const Q& y){return cmp(x,y);}
+
+  bool less(const string& y)
+  {
+    auto n=pref_left<pref_right?pref_left:pref_right;
+    auto m=x_size<y.size()?x_size:y.size();
+    n+=mismatch_index(x_data+n,y.data()+n,m-n);
+    if(n!=m){
+      if(traits::lt(y[n],x_data[n]))return (pref_left=n,true);
+      else                          return (pref_right=n,false);
+    }
+    return n!=x_size?(pref_left=n,true):(pref_right=n,false);
+  }
+
+  bool greater(const string& y)
+  {
+    auto n=pref_left<pref_right?pref_left:pref_right;
+    auto m=x_size<y.size()?x_size:y.size();
+    n+=mismatch_index(x_data+n,y.data()+n,m-n);
+    if(n!=m){
+      if(traits::lt(x_data[n],y[n]))return (pref_right=n,true);
+      else                          return (pref_left=n,false);
+    }
+    return n!=y.size()?(pref_right=n,true):(pref_left=n,false);
+  }
+
+  simd_prefix_less<string> cmp;
+  const string&            x;
+  const CharT*             x_data;
+  size_type                x_size,pref_left,pref_right;
+};
+
 template <typename ForwardIterator,typename T,typename Compare>
 ForwardIterator lower_bound(
   ForwardIterator first,ForwardIterator last,const T& x,Compare comp)
@@ -218,11 +324,638 @@ bool binary_search(
   return (first!=last&&!cbind.greater(*first));
 }
 
+/* Lower bounds of a sorted batch of keys: each search starts at the result
+ * for the previous key and gallops forward (exponentially growing steps)
+ * before binary searching the last step, so that nearby keys are found in
+ * O(log d) for a distance d between results. The prefix binder stays valid
+ * as every probe lies between the closest known bounds.
+ */
+
+template<
+  typename ForwardIterator,typename InputIterator,typename OutputIterator,
+  typename Compare
+>
+OutputIterator lower_bound_sorted_batch(
+  ForwardIterator first,ForwardIterator last,
+  InputIterator keys_first,InputIterator keys_last,
+  OutputIterator out,Compare comp)
+{
+  typename std::iterator_traits<ForwardIterator>::difference_type m,step,count;
+  m=std::distance(first,last);
+  for(;keys_first!=keys_last;++keys_first){
+    auto cbind=comp_bind(comp,*keys_first);
+    for(step=1;step<=m&&cbind.less(*std::next(first,step-1));step*=2){
+      std::advance(first,step);
+      m-=step;
+    }
+    count=step<=m?step-1:m;
+    while(count>0){
+      ForwardIterator it=first;
+      step=count/2;
+      std::advance(it,step);
+      if(cbind.less(*it)){
+        first=++it;
+        m-=step+1;
+        count-=step+1;
+      }
+      else count=step;
+    }
+    *out++=first;
+  }
+  return out;
+}
+
+/* same for dense batches: plain merge */
+
+template<
+  typename ForwardIterator,typename InputIterator,typename OutputIterator,
+  typename Compare
+>
+OutputIterator lower_bound_sorted_merge(
+  ForwardIterator first,ForwardIterator last,
+  InputIterator keys_first,InputIterator keys_last,
+  OutputIterator out,Compare comp)
+{
+  for(;keys_first!=keys_last;++keys_first){
+    while(first!=last&&comp(*first,*keys_first))++first;
+    *out++=first;
+  }
+  return out;
+}
+
+/* The prefix bookkeeping of comp_binder holds for any search where every
+ * element compared lies between the closest elements already known to be
+ * less and not less than x, which includes descents through binary search
+ * trees. bound_key<Binder> wraps a binder as a lookup key so that
+ * transparent_less can feed it to std::set heterogeneous lookup
+ * (is_transparent, C++14) and, as CompatibleCompare, to Boost.MultiIndex
+ * ordered indices and levelorder_vector.
+ */
+
+template<typename Binder>
+struct bound_key
+{
+  Binder* binder;
+};
+
+template<typename Binder>
+bound_key<Binder> make_bound_key(Binder& cbind)
+{
+  return bound_key<Binder>{&cbind};
+}
+
+template<typename Comp>
+struct transparent_less:Comp
+{
+  typedef void is_transparent;
+
+  using Comp::operator();
+
+  template<typename Q,typename Binder>
+  bool operator()(const Q& y,const bound_key<Binder>& k)const
+  {
+    return k.binder->less(y);
+  }
+
+  template<typename Binder,typename Q>
+  bool operator()(const bound_key<Binder>& k,const Q& y)const
+  {
+    return k.binder->greater(y);
+  }
+};
+
+#include <cstddef>
+
+/* number of trailing one bits of n */
+
+inline int trailing_ones(std::size_t n)
+{
+#if defined(__GNUC__)
+  return ~n?__builtin_ctzll(~(unsigned long long)n):(int)(8*sizeof(n));
+#else
+  int res=0;
+  for(;n&1;n>>=1)++res;
+  return res;
+#endif
+}
+
+/* floor(log2(n)), n non-null */
+
+inline int floor_log2(std::size_t n)
+{
+#if defined(__GNUC__)
+  return 63-__builtin_clzll((unsigned long long)n);
+#else
+  int res=0;
+  while(n>>=1)++res;
+  return res;
+#endif
+}
+
+/* Binary search tree in level order (see levelorder_vector.cpp) */
+
+template<typename T>
+class levelorder_vector
+{
+  typedef std::vector<T> vector;
+  
+public:
+  typedef typename vector::value_type             value_type;
+  typedef typename vector::const_iterator         iterator;
+  typedef typename vector::const_iterator         const_iterator;
+  typedef typename vector::size_type              size_type;
+  
+  template<typename InputIterator>
+  levelorder_vector(InputIterator first,InputIterator last)
+  {
+    vector aux(first,last);
+    std::sort(aux.begin(),aux.end());
+    size_type n=aux.size();
+    impl.resize(n);
+    auto it=aux.begin();
+    if(n){
+      for(size_type k=leftmost(1,n);k;k=next_in_order(k,n)){
+        impl[k-1]=std::move(*it++);
+      }
+    }
+  }
+  
+  const_iterator begin()const{return impl.begin();}
+  const_iterator end()const{return impl.end();}
+  size_type      size()const{return impl.size();}
+  
+  const_iterator lower_bound(const T& x)const
+  {
+    return lower_bound(x,std::less<T>());
+  }
+
+  template<typename CompatibleKey,typename CompatibleCompare>
+  const_iterator lower_bound(
+    const CompatibleKey& x,const CompatibleCompare& comp)const
+  {
+    size_type n=impl.size(),i=n,j=0;
+    while(j<n){
+      if(comp(impl[j],x)){
+        j=2*j+2;
+      }
+      else{
+        i=j;
+        j=2*j+1;
+      }
+    }
+    return begin()+i;
+  }
+  
+private:
+  /* leftmost descendant of 1-based node k<=n */
+
+  static size_type leftmost(size_type k,size_type n)
+  {
+    k<<=floor_log2(n)-floor_log2(k);
+    return k<=n?k:k>>1;
+  }
+
+  /* in-order successor of 1-based node k, 0 if none: leftmost node of the
+   * right subtree or, failing that, the parent of the topmost ancestor
+   * reached through right-child links
+   */
+
+  static size_type next_in_order(size_type k,size_type n)
+  {
+    if(2*k+1<=n)return leftmost(2*k+1,n);
+    return k>>(trailing_ones(k)+1);
+  }
+
+  vector impl;
+};
+
+/* Sorted sequence of strings with precomputed LCP (longest common prefix)
+ * information for the fixed midpoints of binary search (Manber-Myers):
+ * llcp[m]/rlcp[m] hold the LCP of element m with the left/right bound of
+ * the interval it is the midpoint of. Tracking the LCPs of x with both
+ * bounds, each step either decides without looking at characters or
+ * resumes comparison where the known prefix ends, for O(log n + |x|)
+ * character comparisons in total. Input must be sorted.
+ */
+
+template<typename String>
+class lcp_sorted_vector
+{
+  typedef std::vector<String>                     vector;
+  typedef prefix_less_value_traits<String>        value_traits;
+
+public:
+  typedef typename vector::value_type             value_type;
+  typedef typename vector::const_iterator         iterator;
+  typedef typename vector::const_iterator         const_iterator;
+  typedef typename vector::difference_type        difference_type;
+  typedef typename vector::size_type              size_type;
+
+  template<typename InputIterator>
+  lcp_sorted_vector(InputIterator first,InputIterator last):
+    impl(first,last),llcp(impl.size()),rlcp(impl.size())
+  {
+    std::vector<size_type> adj(impl.size()+1,0); /* adj[i]=lcp(s[i-1],s[i]) */
+    for(size_type i=1;i<impl.size();++i){
+      adj[i]=lcp(impl[i-1],impl[i],0);
+    }
+    build(-1,(difference_type)impl.size(),adj);
+  }
+
+  const_iterator begin()const{return impl.begin();}
+  const_iterator end()const{return impl.end();}
+  size_type      size()const{return impl.size();}
+
+  const_iterator lower_bound(const String& x)const
+  {
+    /* invariant: s[L]<x<=s[R], l=lcp(x,s[L]), r=lcp(x,s[R]) */
+
+    difference_type L=-1,R=impl.size();
+    size_type       l=0,r=0;
+    while(R-L>1){
+      difference_type M=L+(R-L)/2;
+      const String&   y=impl[M];
+      if(l>=r){
+        if(llcp[M]>l){L=M;continue;}
+        if(llcp[M]<l){R=M;r=llcp[M];continue;}
+      }
+      else{
+        if(rlcp[M]>r){R=M;continue;}
+        if(rlcp[M]<r){L=M;l=rlcp[M];continue;}
+      }
+      size_type k=lcp(x,y,l>=r?l:r);
+      if(k==x.size()||(k!=y.size()&&value_traits::lt(x[k],y[k]))){
+        R=M;r=k;
+      }
+      else{
+        L=M;l=k;
+      }
+    }
+    return begin()+R;
+  }
+
+  bool binary_search(const String& x)const
+  {
+    auto it=lower_bound(x);
+    return it!=end()&&it->size()==x.size()&&lcp(x,*it,0)==x.size();
+  }
+
+private:
+  static bool eq(
+    const typename String::value_type& x,const typename String::value_type& y)
+  {
+    return !value_traits::lt(x,y)&&!value_traits::lt(y,x);
+  }
+
+  /* lcp of x and y known to share their first k elements */
+
+  static size_type lcp(const String& x,const String& y,size_type k)
+  {
+    size_type m=x.size()<y.size()?x.size():y.size();
+    while(k<m&&eq(x[k],y[k]))++k;
+    return k;
+  }
+
+  /* fills llcp/rlcp for midpoints in (L,R), returns lcp(s[L],s[R]) (0 for
+   * the virtual bounds -1 and n)
+   */
+
+  size_type build(
+    difference_type L,difference_type R,const std::vector<size_type>& adj)
+  {
+    if(R-L<=1){
+      return L<0||R>=(difference_type)impl.size()?0:adj[R];
+    }
+    difference_type M=L+(R-L)/2;
+    llcp[M]=build(L,M,adj);
+    rlcp[M]=build(M,R,adj);
+    return llcp[M]<rlcp[M]?llcp[M]:rlcp[M];
+  }
+
+  vector                 impl;
+  std::vector<size_type> llcp,rlcp;
+};
+
+/* Path-compressed radix tree (trie) over a sorted set of strings, for
+ * comparison with binary search: shared prefixes are stored once and looked
+ * at once. Nodes live in a single array with the children of each node
+ * contiguous and sorted by their first element, so child selection is a
+ * binary search over the actual fan-out (element types can be wide, which
+ * rules out fixed-size, byte-indexed nodes). Edge labels are not copied but
+ * referred to as [depth_begin,depth_end) ranges of some key below the node.
+ * Each node records the rank range of its keys, so find and lower_bound
+ * return iterators into the sorted key sequence.
+ */
+
+template<typename String>
+class radix_tree
+{
+  typedef std::vector<String>                     vector;
+  typedef prefix_less_value_traits<String>        value_traits;
+  typedef typename String::value_type             element_type;
+
+public:
+  typedef typename vector::value_type             value_type;
+  typedef typename vector::const_iterator         iterator;
+  typedef typename vector::const_iterator         const_iterator;
+  typedef typename vector::size_type              size_type;
+
+  template<typename InputIterator>
+  radix_tree(InputIterator first,InputIterator last):keys(first,last)
+  {
+    std::sort(keys.begin(),keys.end());
+    keys.erase(std::unique(keys.begin(),keys.end()),keys.end());
+    if(!keys.empty()){
+      nodes.resize(1);
+      build(0,0,keys.size(),0);
+    }
+  }
+
+  const_iterator begin()const{return keys.begin();}
+  const_iterator end()const{return keys.end();}
+  size_type      size()const{return keys.size();}
+
+  const_iterator find(const String& x)const
+  {
+    if(nodes.empty())return end();
+    size_type i=0;
+    for(;;){
+      const node&   nd=nodes[i];
+      const String& label=keys[nd.key];
+      if(x.size()<nd.depth_end)return end();
+      for(size_type d=nd.depth_begin;d<nd.depth_end;++d){
+        if(!eq(x[d],label[d]))return end();
+      }
+      if(x.size()==nd.depth_end){
+        return nd.terminal?begin()+nd.rank_begin:end();
+      }
+      size_type j=child_lower_bound(nd,x[nd.depth_end]);
+      if(j==nd.first_child+nd.num_children||
+         value_traits::lt(x[nd.depth_end],firsts[j-1]))return end();
+      i=j;
+    }
+  }
+
+  const_iterator lower_bound(const String& x)const
+  {
+    if(nodes.empty())return end();
+    size_type i=0;
+    for(;;){
+      const node&   nd=nodes[i];
+      const String& label=keys[nd.key];
+      for(size_type d=nd.depth_begin;d<nd.depth_end;++d){
+        if(d==x.size()||value_traits::lt(x[d],label[d])){
+          return begin()+nd.rank_begin;
+        }
+        if(value_traits::lt(label[d],x[d]))return begin()+nd.rank_end;
+      }
+      if(x.size()==nd.depth_end)return begin()+nd.rank_begin;
+      size_type j=child_lower_bound(nd,x[nd.depth_end]);
+      if(j==nd.first_child+nd.num_children)return begin()+nd.rank_end;
+      if(value_traits::lt(x[nd.depth_end],firsts[j-1])){
+        return begin()+nodes[j].rank_begin;
+      }
+      i=j;
+    }
+  }
+
+private:
+  struct node
+  {
+    size_type    key;         /* a key passing through the node */
+    size_type    depth_begin,depth_end;
+    size_type    first_child,num_children;
+    size_type    rank_begin,rank_end;
+    bool         terminal;    /* keys[rank_begin] ends here */
+  };
+
+  static bool eq(const element_type& x,const element_type& y)
+  {
+    return !value_traits::lt(x,y)&&!value_traits::lt(y,x);
+  }
+
+  size_type child_lower_bound(const node& nd,const element_type& x)const
+  {
+    size_type lo=nd.first_child,hi=lo+nd.num_children;
+    while(lo<hi){
+      size_type mid=lo+(hi-lo)/2;
+      if(value_traits::lt(firsts[mid-1],x))lo=mid+1;
+      else                                    hi=mid;
+    }
+    return lo;
+  }
+
+  /* builds node i for keys [lo,hi), which share their first depth elements */
+
+  void build(size_type i,size_type lo,size_type hi,size_type depth)
+  {
+    const String& x=keys[lo];
+    const String& y=keys[hi-1];
+    size_type     end=depth,m=x.size()<y.size()?x.size():y.size();
+    while(end<m&&eq(x[end],y[end]))++end;
+
+    node& nd=nodes[i];
+    nd.key=lo;
+    nd.depth_begin=depth;
+    nd.depth_end=end;
+    nd.rank_begin=lo;
+    nd.rank_end=hi;
+    nd.terminal=(x.size()==end);
+    if(nd.terminal)++lo;
+
+    /* allocate children contiguously before recursing */
+
+    size_type first_child=nodes.size(),num_children=0;
+    for(size_type k=lo;k<hi;++num_children){
+      size_type l=k+1;
+      while(l<hi&&eq(keys[l][end],keys[k][end]))++l;
+      firsts.push_back(keys[k][end]);
+      k=l;
+    }
+    nodes[i].first_child=first_child;
+    nodes[i].num_children=num_children;
+    nodes.resize(first_child+num_children);
+
+    for(size_type k=lo,c=first_child;k<hi;++c){
+      size_type l=k+1;
+      while(l<hi&&eq(keys[l][end],keys[k][end]))++l;
+      build(c,k,l,end);
+      k=l;
+    }
+  }
+
+  vector                    keys;
+  std::vector<node>         nodes;
+  std::vector<element_type> firsts; /* first label element of node i+1 */
+};
+
+/* Numeric keys: interpolation-then-binary lower_bound. Each interpolation
+ * step probes the estimated position and the element a guard (one cache
+ * line) away from it: if the key falls inside the guard window the search
+ * finishes with a binary search over that line, otherwise the range is cut
+ * at the probe. Skewed inputs fall back to binary search after a few steps.
+ */
+
+template<typename RandomAccessIterator,typename T>
+RandomAccessIterator interpolation_lower_bound(
+  RandomAccessIterator first,RandomAccessIterator last,const T& x)
+{
+  typedef typename std::iterator_traits<
+    RandomAccessIterator>::value_type               value_type;
+  typedef typename std::iterator_traits<
+    RandomAccessIterator>::difference_type          difference_type;
+  static const difference_type guard=
+    64/sizeof(value_type)?64/sizeof(value_type):1;
+  static const int             max_steps=3;
+
+  for(int steps=0;steps<max_steps&&last-first>2*guard;++steps){
+    const value_type& lo=*first;
+    const value_type& hi=*(last-1);
+    if(!(lo<x))return first;
+    if(hi<x)return last;
+    RandomAccessIterator pos=first+difference_type(
+      (double(x)-double(lo))/(double(hi)-double(lo))*double(last-first-1));
+    if(*pos<x){
+      first=pos+1;
+      if(last-first>guard&&!(first[guard-1]<x)){
+        last=first+guard;
+        break;
+      }
+    }
+    else{
+      last=pos;
+      if(last-first>guard&&last[-guard]<x){
+        first=last-guard+1;
+        break;
+      }
+    }
+  }
+  return std::lower_bound(first,last,x);
+}
+
+/* Learned index: a piecewise-linear model of the position of each distinct
+ * key in a sorted vector, with segments built by a greedy shrinking cone so
+ * that every prediction is off by at most Error positions. lower_bound
+ * locates the segment, predicts and binary searches the 2*Error+2 wide
+ * window around the prediction. Keys are integral so that the model can be
+ * pinned at the successor of every key.
+ */
+
+template<typename T,std::size_t Error=32>
+class pla_sorted_vector
+{
+  static_assert(
+    std::is_integral<T>::value,"pla_sorted_vector requires integral keys");
+
+  typedef std::vector<T> vector;
+
+public:
+  typedef typename vector::value_type     value_type;
+  typedef typename vector::const_iterator iterator;
+  typedef typename vector::const_iterator const_iterator;
+  typedef typename vector::size_type      size_type;
+
+  template<typename InputIterator>
+  pla_sorted_vector(InputIterator first,InputIterator last):
+    keys(first,last)
+  {
+    std::sort(keys.begin(),keys.end());
+    build();
+  }
+
+  const_iterator begin()const{return keys.begin();}
+  const_iterator end()const{return keys.end();}
+  size_type      size()const{return keys.size();}
+  size_type      num_segments()const{return firsts.size();}
+
+  const_iterator lower_bound(const T& x)const
+  {
+    if(firsts.empty()||!(firsts.front()<x))return begin();
+    if(keys.back()<x)return end();
+    size_type s=size_type(
+      std::upper_bound(firsts.begin(),firsts.end(),x)-firsts.begin())-1;
+    const segment& seg=segments[s];
+    size_type      lo=seg.pos,
+                   hi=s+1<segments.size()?segments[s+1].pos:keys.size();
+    double         p=double(seg.pos)+seg.slope*(double(x)-double(firsts[s]));
+    if(p>double(lo+Error))lo=std::min(size_type(p)-Error,hi);
+    if(p+double(Error+2)<double(hi))hi=size_type(p)+Error+2;
+    return std::lower_bound(begin()+lo,begin()+hi,x);
+  }
+
+private:
+  struct segment
+  {
+    size_type pos;
+    double    slope;
+  };
+
+  /* For lookups of absent keys to stay within the error bound, the model
+   * is also fit at the successor of each key preceding a gap.
+   */
+
+  void build()
+  {
+    cone c={0.0,0.0,0.0,0};
+    for(size_type i=0,n=keys.size();i<n;++i){
+      if(i&&!(keys[i-1]<keys[i]))continue;
+      if(i){
+        T x=keys[i-1]+1;
+        if(x<keys[i])add_point(c,x,i);
+      }
+      add_point(c,keys[i],i);
+    }
+    if(!segments.empty())segments.back().slope=c.slope();
+  }
+
+  struct cone
+  {
+    double slope()const
+    {
+      return shi<std::numeric_limits<double>::infinity()?(slo+shi)/2:0.0;
+    }
+
+    double    slo,shi,x0;
+    size_type i0;
+  };
+
+  void add_point(cone& c,const T& key,size_type i)
+  {
+    double x=double(key);
+    if(!firsts.empty()&&x>c.x0){
+      double dx=x-c.x0,
+             l=(double(i)-double(c.i0)-double(Error))/dx,
+             h=(double(i)-double(c.i0)+double(Error))/dx;
+      if(l<=c.shi&&c.slo<=h){
+        if(l>c.slo)c.slo=l;
+        if(h<c.shi)c.shi=h;
+        return;
+      }
+    }
+    if(!segments.empty())segments.back().slope=c.slope();
+    firsts.push_back(key);
+    segments.push_back({i,0.0});
+    c.x0=x;
+    c.i0=i;
+    c.slo=0.0;
+    c.shi=std::numeric_limits<double>::infinity();
+  }
+
+  vector               keys;
+  vector               firsts; /* first key of each segment */
+  std::vector<segment> segments;
+};
+
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <set>
 #include <vector>
+#include <boost/iterator/function_output_iterator.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/ordered_index.hpp>
 
 template<typename Comp>
 struct run_lower_bound{
@@ -256,6 +989,229 @@ struct run_binary_search{
   }
 };
 
+template<typename T,typename Compare,typename Allocator,typename Binder>
+typename std::set<T,Compare,Allocator>::const_iterator
+prefix_lower_bound(
+  const std::set<T,Compare,Allocator>& c,const bound_key<Binder>& k)
+{
+  return c.lower_bound(k);
+}
+
+template<typename Container,typename Binder>
+typename Container::const_iterator
+prefix_lower_bound(const Container& c,const bound_key<Binder>& k)
+{
+  return c.lower_bound(
+    k,transparent_less<std::less<typename Container::value_type>>());
+}
+
+template<typename Comp>
+struct run_tree_lower_bound;
+
+template<typename T>
+struct run_tree_lower_bound<std::less<T>>{
+  typedef unsigned int result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& s)const
+  {
+    unsigned int res=0;
+    for(const auto& x:s){
+      if(*(c.lower_bound(x))==x)++res;
+    }
+    return res;
+  }
+};
+
+template<typename T>
+struct run_tree_lower_bound<prefix_less<T>>{
+  typedef unsigned int result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& s)const
+  {
+    unsigned int res=0;
+    for(const auto& x:s){
+      auto cbind=comp_bind(prefix_less<T>(),x);
+      if(*(prefix_lower_bound(c,make_bound_key(cbind)))==x)++res;
+    }
+    return res;
+  }
+};
+
+template<typename Container,typename Sequence>
+void profile_container(const Sequence& s)
+{
+  typedef typename Sequence::value_type value_type;
+
+  Container c(s.begin(),s.end());
+
+  auto res1=run_tree_lower_bound<std::less<value_type>>()(c,s);
+  auto res2=run_tree_lower_bound<prefix_less<value_type>>()(c,s);
+  if(res1!=res2){
+    std::cerr<<"prefix_less implementation bug\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  double t=measure(std::bind(
+    run_tree_lower_bound<std::less<value_type>>(),std::cref(c),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(
+    run_tree_lower_bound<prefix_less<value_type>>(),
+    std::cref(c),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+}
+
+template<typename Sequence>
+void profile_containers(const char* name,const Sequence& s)
+{
+  typedef typename Sequence::value_type value_type;
+  typedef std::set<
+    value_type,transparent_less<std::less<value_type>>
+  >                                     set;
+  typedef boost::multi_index_container<
+    value_type,
+    boost::multi_index::indexed_by<
+      boost::multi_index::ordered_unique<
+        boost::multi_index::identity<value_type>
+      >
+    >
+  >                                     multi_index;
+
+  std::cout<<name<<";"<<s.size();
+  profile_container<set>(s);
+  profile_container<multi_index>(s);
+  profile_container<levelorder_vector<value_type>>(s);
+  std::cout<<std::endl;
+}
+
+/* Sequence searched for all its elements as a single sorted batch */
+
+template<typename Comp>
+struct run_lower_bound_sorted_batch{
+  typedef unsigned int result_type;
+
+  template<typename Sequence>
+  result_type operator()(const Sequence& s)const
+  {
+    unsigned int res=0;
+    auto         key=s.begin();
+    ::lower_bound_sorted_batch(
+      s.begin(),s.end(),s.begin(),s.end(),
+      boost::make_function_output_iterator(
+        [&](typename Sequence::const_iterator it){if(*it==*key++)++res;}),
+      Comp());
+    return res;
+  }
+};
+
+template<typename Comp>
+struct run_lower_bound_sorted_merge{
+  typedef unsigned int result_type;
+
+  template<typename Sequence>
+  result_type operator()(const Sequence& s)const
+  {
+    unsigned int res=0;
+    auto         key=s.begin();
+    ::lower_bound_sorted_merge(
+      s.begin(),s.end(),s.begin(),s.end(),
+      boost::make_function_output_iterator(
+        [&](typename Sequence::const_iterator it){if(*it==*key++)++res;}),
+      Comp());
+    return res;
+  }
+};
+
+struct run_radix_find{
+  typedef unsigned int result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& s)const
+  {
+    unsigned int res=0;
+    for(const auto& x:s){
+      if(c.find(x)!=c.end())++res;
+    }
+    return res;
+  }
+};
+
+/* lower_bound member of a structure built over the sequence */
+
+struct run_index_lower_bound{
+  typedef unsigned int result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& s)const
+  {
+    unsigned int res=0;
+    for(const auto& x:s){
+      if(*(c.lower_bound(x))==x)++res;
+    }
+    return res;
+  }
+};
+
+struct run_lcp_binary_search{
+  typedef unsigned int result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& s)const
+  {
+    unsigned int res=0;
+    for(const auto& x:s){
+      if(c.binary_search(x))++res;
+    }
+    return res;
+  }
+};
+
+/* numeric keys: sum of the positions found for every query */
+
+struct run_numeric_lower_bound{
+  typedef std::size_t result_type;
+
+  template<typename Sequence>
+  result_type operator()(const Sequence& s,const Sequence& q)const
+  {
+    std::size_t res=0;
+    for(const auto& x:q){
+      res+=std::size_t(std::lower_bound(s.begin(),s.end(),x)-s.begin());
+    }
+    return res;
+  }
+};
+
+struct run_interpolation_lower_bound{
+  typedef std::size_t result_type;
+
+  template<typename Sequence>
+  result_type operator()(const Sequence& s,const Sequence& q)const
+  {
+    std::size_t res=0;
+    for(const auto& x:q){
+      res+=std::size_t(interpolation_lower_bound(s.begin(),s.end(),x)-s.begin());
+    }
+    return res;
+  }
+};
+
+struct run_pla_lower_bound{
+  typedef std::size_t result_type;
+
+  template<typename Container,typename Sequence>
+  result_type operator()(const Container& c,const Sequence& q)const
+  {
+    std::size_t res=0;
+    for(const auto& x:q){
+      res+=std::size_t(c.lower_bound(x)-c.begin());
+    }
+    return res;
+  }
+};
+
 template<typename Sequence>
 void profile(const char* name,const Sequence& s)
 {
@@ -267,7 +1223,20 @@ void profile(const char* name,const Sequence& s)
   auto res2=run_lower_bound<prefix_less<value_type>>()(s);
   auto res3=run_binary_search<std::less<value_type>>()(s);
   auto res4=run_binary_search<prefix_less<value_type>>()(s);
-  if(!(res1==res2&&res3==res4)){
+  auto res5=run_lower_bound<simd_prefix_less<value_type>>()(s);
+  auto res6=run_binary_search<simd_prefix_less<value_type>>()(s);
+  lcp_sorted_vector<value_type> ls(s.begin(),s.end());
+  auto res7=run_index_lower_bound()(ls,s);
+  auto res8=run_lcp_binary_search()(ls,s);
+  auto res9=run_lower_bound_sorted_batch<std::less<value_type>>()(s);
+  auto res10=run_lower_bound_sorted_batch<prefix_less<value_type>>()(s);
+  auto res11=run_lower_bound_sorted_merge<std::less<value_type>>()(s);
+  radix_tree<value_type> rt(s.begin(),s.end());
+  auto res12=run_index_lower_bound()(rt,s);
+  auto res13=run_radix_find()(rt,s);
+  if(!(res1==res2&&res1==res5&&res1==res7&&
+       res1==res9&&res1==res10&&res1==res11&&res1==res12&&res3==res13&&
+       res3==res4&&res3==res6&&res3==res8)){
     std::cerr<<"prefix_less implementation bug\n";
     std::exit(EXIT_FAILURE);
   }
@@ -288,9 +1257,115 @@ void profile(const char* name,const Sequence& s)
 
   t=measure(
     std::bind(run_binary_search<prefix_less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(
+    std::bind(run_lower_bound<simd_prefix_less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(
+    std::bind(run_binary_search<simd_prefix_less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(
+    std::bind(run_index_lower_bound(),std::cref(ls),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(
+    std::bind(run_lcp_binary_search(),std::cref(ls),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(
+    run_lower_bound_sorted_batch<std::less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(
+    run_lower_bound_sorted_batch<prefix_less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(
+    run_lower_bound_sorted_merge<std::less<value_type>>(),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(run_index_lower_bound(),std::cref(rt),std::cref(s)));
+  std::cout<<";"<<(t/s.size())*10E6;
+
+  t=measure(std::bind(run_radix_find(),std::cref(rt),std::cref(s)));
   std::cout<<";"<<(t/s.size())*10E6<<std::endl;
 }
 
+/* lookups of keys drawn from the set, half of them shifted by one so that
+ * misses are also exercised
+ */
+
+template<typename Sequence>
+Sequence numeric_queries(const Sequence& s,std::size_t n=1000000)
+{
+  std::mt19937_64                            gen(34862);
+  std::uniform_int_distribution<std::size_t> dist(0,s.size()-1);
+  Sequence                                   q;
+  for(std::size_t i=0;i<n;++i)q.push_back(s[dist(gen)]+(i&1));
+  return q;
+}
+
+template<typename Sequence>
+void profile_numeric(const char* name,const Sequence& s)
+{
+  typedef typename Sequence::value_type value_type;
+
+  Sequence                      q=numeric_queries(s);
+  pla_sorted_vector<value_type> pv(s.begin(),s.end());
+
+  /* pretest */
+
+  auto res1=run_numeric_lower_bound()(s,q);
+  auto res2=run_interpolation_lower_bound()(s,q);
+  auto res3=run_pla_lower_bound()(pv,q);
+  if(!(res1==res2&&res1==res3)){
+    std::cerr<<"numeric lower_bound implementation bug\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::cout<<name<<";"<<s.size()<<";"<<pv.num_segments();
+
+  double t=measure(
+    std::bind(run_numeric_lower_bound(),std::cref(s),std::cref(q)));
+  std::cout<<";"<<(t/q.size())*10E6;
+
+  t=measure(
+    std::bind(run_interpolation_lower_bound(),std::cref(s),std::cref(q)));
+  std::cout<<";"<<(t/q.size())*10E6;
+
+  t=measure(std::bind(run_pla_lower_bound(),std::cref(pv),std::cref(q)));
+  std::cout<<";"<<(t/q.size())*10E6<<std::endl;
+}
+
+std::vector<unsigned int> uniform_keys(std::size_t n)
+{
+  std::mt19937                                gen(73652);
+  std::uniform_int_distribution<unsigned int> dist;
+  std::vector<unsigned int>                   v;
+  v.reserve(n);
+  for(std::size_t i=0;i<n;++i)v.push_back(dist(gen));
+  std::sort(v.begin(),v.end());
+  return v;
+}
+
+std::vector<unsigned int> lognormal_keys(std::size_t n)
+{
+  static const double max=double(std::numeric_limits<unsigned int>::max());
+
+  std::mt19937                     gen(73652);
+  std::lognormal_distribution<>    dist(0.0,2.0);
+  std::vector<unsigned int>        v;
+  v.reserve(n);
+  for(std::size_t i=0;i<n;++i){
+    v.push_back((unsigned int)(std::min(dist(gen)*1.0E6,max)));
+  }
+  std::sort(v.begin(),v.end());
+  return v;
+}
+
 template<typename Value>
 struct value_conv
 {
@@ -365,7 +1440,11 @@ std::vector<Value> sorted_quijote()
 int main()
 {
   std::cout<<"name;size;lower_bound;pref lower_bound;"
-            "binary_search;pref binary_search\n";
+            "binary_search;pref binary_search;"
+            "simd pref lower_bound;simd pref binary_search;"
+            "lcp lower_bound;lcp binary_search;"
+            "batch lower_bound;pref batch lower_bound;merge lower_bound;"
+            "radix lower_bound;radix find\n";
 
   profile("S(2,4)", strings<std::string>(2,4));
   profile("S(2,10)",strings<std::string>(2,10));
@@ -398,4 +1477,20 @@ int main()
   profile("S(10,6)(vec<str>)",strings<std::vector<std::string>>(10,6));
   profile("S(20,4)(vec<str>)",strings<std::vector<std::string>>(20,4));
   profile("Quijote(vec<str>)",sorted_quijote<std::vector<std::string>>());
+
+  std::cout<<"name;size;std::set;pref std::set;multi_index;pref multi_index;"
+             "levelorder_vector;pref levelorder_vector\n";
+
+  profile_containers("Quijote",sorted_quijote<std::string>());
+  profile_containers("Quijote(wstr)",sorted_quijote<std::wstring>());
+
+  std::cout<<"name;size;segments;lower_bound;"
+             "interpolation lower_bound;learned lower_bound\n";
+
+  for(std::size_t n:{10000,100000,1000000,10000000,100000000}){
+    profile_numeric("uniform",uniform_keys(n));
+  }
+  for(std::size_t n:{10000,100000,1000000,10000000,100000000}){
+    profile_numeric("lognormal",lognormal_keys(n));
+  }
 }
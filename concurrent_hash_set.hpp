@@ -0,0 +1,207 @@
+/* Hash set for concurrent access with per-shard locking.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef CONCURRENT_HASH_SET_HPP_7C0D5E52_CB47_11F1_A1B3_02FC00000001
+#define CONCURRENT_HASH_SET_HPP_7C0D5E52_CB47_11F1_A1B3_02FC00000001
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+
+/* Elements are distributed by hash among a power-of-two number of shards,
+ * each a boost::unordered_set (or multiset) guarded by its own mutex, so
+ * that threads working on different bucket groups do not contend. Shards
+ * are padded to keep neighbouring mutexes out of the same cache line.
+ * As iterators cannot outlive the lock, lookup is done by visitation:
+ * find and equal_range invoke a function on the matching elements while
+ * the shard is locked.
+ */
+
+namespace concurrent_hash_set_detail{
+
+template<typename T,typename Hash,typename Pred,bool Unique>
+class table
+{
+  typedef typename std::conditional<
+    Unique,
+    boost::unordered_set<T,Hash,Pred>,
+    boost::unordered_multiset<T,Hash,Pred>
+  >::type                                           shard_container;
+
+  struct shard
+  {
+    std::mutex      mutex;
+    shard_container c;
+    char            pad[64];
+  };
+
+  typedef std::lock_guard<std::mutex>               lock_guard;
+
+public:
+  // types:
+
+  typedef T                                         key_type;
+  typedef T                                         value_type;
+  typedef Hash                                      hasher;
+  typedef Pred                                      key_equal;
+  typedef std::size_t                               size_type;
+
+  // construct/destroy:
+
+  explicit table(size_type num_shards=64,const Hash& h=Hash()):
+    h(h),bits(0),mlf(shard_container().max_load_factor())
+  {
+    while((size_type(1)<<bits)<num_shards)++bits;
+    shards.reset(new shard[this->num_shards()]);
+  }
+
+  table(const table&)=delete;
+  table& operator=(const table&)=delete;
+
+  // capacity:
+
+  /* not a snapshot: shards are locked one at a time */
+
+  size_type size()const
+  {
+    size_type res=0;
+    for(size_type i=0;i<num_shards();++i){
+      lock_guard lck(shards[i].mutex);
+      res+=shards[i].c.size();
+    }
+    return res;
+  }
+
+  size_type num_shards()const{return size_type(1)<<bits;}
+
+  // modifiers:
+
+  /* for multisets the element is always inserted */
+
+  bool insert(const T& x)
+  {
+    shard&     s=shard_for(x);
+    lock_guard lck(s.mutex);
+    return insert(s.c,x,std::integral_constant<bool,Unique>());
+  }
+
+  size_type erase(const T& x)
+  {
+    shard&     s=shard_for(x);
+    lock_guard lck(s.mutex);
+    return s.c.erase(x);
+  }
+
+  // lookup:
+
+  template<typename F>
+  bool find(const T& x,F f)const
+  {
+    shard&     s=shard_for(x);
+    lock_guard lck(s.mutex);
+    auto       it=s.c.find(x);
+    if(it==s.c.end())return false;
+    f(*it);
+    return true;
+  }
+
+  bool contains(const T& x)const
+  {
+    return find(x,[](const T&){});
+  }
+
+  template<typename F>
+  size_type equal_range(const T& x,F f)const
+  {
+    shard&     s=shard_for(x);
+    lock_guard lck(s.mutex);
+    size_type  res=0;
+    for(auto p=s.c.equal_range(x);p.first!=p.second;++p.first,++res){
+      f(*p.first);
+    }
+    return res;
+  }
+
+  size_type count(const T& x)const
+  {
+    return equal_range(x,[](const T&){});
+  }
+
+  // hash policy:
+
+  /* the value last set, common to all shards */
+
+  float max_load_factor()const{return mlf;}
+
+  void max_load_factor(float z)
+  {
+    mlf=z;
+    for(size_type i=0;i<num_shards();++i){
+      lock_guard lck(shards[i].mutex);
+      shards[i].c.max_load_factor(z);
+    }
+  }
+
+  /* n is the total bucket count, spread evenly among shards */
+
+  void rehash(size_type n)
+  {
+    for(size_type i=0;i<num_shards();++i){
+      lock_guard lck(shards[i].mutex);
+      shards[i].c.rehash(n/num_shards()+1);
+    }
+  }
+
+private:
+  /* top bits of the mixed hash, so that shards use different hash bits
+   * than the buckets within them
+   */
+
+  shard& shard_for(const T& x)const
+  {
+    std::uint64_t z=std::uint64_t(h(x))*0x9E3779B97F4A7C15ull;
+    return shards[bits?size_type(z>>(64-bits)):0];
+  }
+
+  static bool insert(shard_container& c,const T& x,std::true_type)
+  {
+    return c.insert(x).second;
+  }
+
+  static bool insert(shard_container& c,const T& x,std::false_type)
+  {
+    c.insert(x);
+    return true;
+  }
+
+  Hash                     h;
+  unsigned int             bits; /* log2 of the number of shards */
+  float                    mlf;
+  std::unique_ptr<shard[]> shards;
+};
+
+} //namespace concurrent_hash_set_detail
+
+template<
+  typename T,typename Hash=boost::hash<T>,typename Pred=std::equal_to<T>
+>
+using concurrent_hash_set=
+  concurrent_hash_set_detail::table<T,Hash,Pred,true>;
+
+template<
+  typename T,typename Hash=boost::hash<T>,typename Pred=std::equal_to<T>
+>
+using concurrent_hash_multiset=
+  concurrent_hash_set_detail::table<T,Hash,Pred,false>;
+
+#endif
@@ -0,0 +1,100 @@
+/* Allocator keeping track of the memory requested by a container.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef COUNTING_ALLOCATOR_HPP_4E8D2B10_CB5A_11F1_8F6A_02FC00000001
+#define COUNTING_ALLOCATOR_HPP_4E8D2B10_CB5A_11F1_8F6A_02FC00000001
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+/* counting_allocator<T> forwards to std::allocator<T> and adds the bytes
+ * requested and released to a global tally shared by all instantiations,
+ * which gives the footprint of a container including bucket arrays, nodes
+ * and whatever else it allocates internally. Counters are not atomic: the
+ * tally is meant for single-threaded measurements.
+ */
+
+struct allocation_stats
+{
+  std::size_t bytes;       /* currently allocated */
+  std::size_t peak_bytes;  /* maximum of bytes since the last reset */
+  std::size_t allocations; /* calls to allocate since the last reset */
+};
+
+namespace counting_allocator_detail{
+
+inline allocation_stats& stats()
+{
+  static allocation_stats s={0,0,0};
+  return s;
+}
+
+} //namespace counting_allocator_detail
+
+inline allocation_stats get_allocation_stats()
+{
+  return counting_allocator_detail::stats();
+}
+
+inline void reset_allocation_stats()
+{
+  allocation_stats& s=counting_allocator_detail::stats();
+  s.peak_bytes=s.bytes;
+  s.allocations=0;
+}
+
+template<typename T>
+class counting_allocator
+{
+public:
+  typedef T              value_type;
+  typedef T*             pointer;
+  typedef const T*       const_pointer;
+  typedef T&             reference;
+  typedef const T&       const_reference;
+  typedef std::size_t    size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template<typename U>
+  struct rebind{typedef counting_allocator<U> other;};
+
+  counting_allocator(){}
+  template<typename U>
+  counting_allocator(const counting_allocator<U>&){}
+
+  T* allocate(std::size_t n)
+  {
+    T*                p=std::allocator<T>().allocate(n);
+    allocation_stats& s=counting_allocator_detail::stats();
+    s.bytes+=n*sizeof(T);
+    s.peak_bytes=(std::max)(s.peak_bytes,s.bytes);
+    ++s.allocations;
+    return p;
+  }
+
+  void deallocate(T* p,std::size_t n)
+  {
+    counting_allocator_detail::stats().bytes-=n*sizeof(T);
+    std::allocator<T>().deallocate(p,n);
+  }
+};
+
+template<typename T,typename U>
+bool operator==(const counting_allocator<T>&,const counting_allocator<U>&)
+{
+  return true;
+}
+
+template<typename T,typename U>
+bool operator!=(const counting_allocator<T>&,const counting_allocator<U>&)
+{
+  return false;
+}
+
+#endif
@@ -52,6 +52,137 @@ void resume_timing()
   measure_start+=std::chrono::high_resolution_clock::now()-measure_pause;
 }
 
+/* Hardware counters through Linux perf_event_open. Events are opened
+ * individually (not as a group) so that the kernel can multiplex them when
+ * the PMU lacks enough counters; readings are scaled by enabled/running
+ * time accordingly. Unavailable events (no permission, non-Linux, virtualized
+ * PMU) read as negative.
+ */
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <cstring>
+
+class perf_counters
+{
+public:
+  static const int num_events=6;
+  using result_type=std::array<double,num_events>;
+
+  static const char* name(int i)
+  {
+    static const char* names[num_events]={
+      "cycles","instructions","L1 misses","LLC misses",
+      "branch misses","dTLB misses"
+    };
+    return names[i];
+  }
+
+  perf_counters()
+  {
+    fds.fill(-1);
+#if defined(__linux__)
+    static const std::uint64_t cache_read_miss=
+      (PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+    static const std::uint32_t types[num_events]={
+      PERF_TYPE_HARDWARE,PERF_TYPE_HARDWARE,PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HW_CACHE,PERF_TYPE_HARDWARE,PERF_TYPE_HW_CACHE
+    };
+    static const std::uint64_t configs[num_events]={
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_L1D|cache_read_miss,
+      PERF_COUNT_HW_CACHE_LL|cache_read_miss,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_DTLB|cache_read_miss
+    };
+
+    for(int i=0;i<num_events;++i){
+      perf_event_attr attr;
+      std::memset(&attr,0,sizeof(attr));
+      attr.size=sizeof(attr);
+      attr.type=types[i];
+      attr.config=configs[i];
+      attr.disabled=1;
+      attr.exclude_kernel=1;
+      attr.exclude_hv=1;
+      attr.read_format=
+        PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[i]=(int)syscall(SYS_perf_event_open,&attr,0,-1,-1,0);
+    }
+#endif
+  }
+
+  perf_counters(const perf_counters&)=delete;
+  perf_counters& operator=(const perf_counters&)=delete;
+
+  ~perf_counters()
+  {
+#if defined(__linux__)
+    for(int fd:fds)if(fd>=0)close(fd);
+#endif
+  }
+
+  void start()
+  {
+#if defined(__linux__)
+    for(int fd:fds)if(fd>=0){
+      ioctl(fd,PERF_EVENT_IOC_RESET,0);
+      ioctl(fd,PERF_EVENT_IOC_ENABLE,0);
+    }
+#endif
+  }
+
+  result_type stop()
+  {
+    result_type res;
+    res.fill(-1.0);
+#if defined(__linux__)
+    for(int fd:fds)if(fd>=0)ioctl(fd,PERF_EVENT_IOC_DISABLE,0);
+    for(int i=0;i<num_events;++i){
+      std::uint64_t data[3]; /* value, time enabled, time running */
+      if(fds[i]<0||::read(fds[i],data,sizeof(data))!=sizeof(data))continue;
+      if(data[2]==0)continue;
+      res[i]=(double)data[0]*((double)data[1]/(double)data[2]);
+    }
+#endif
+    return res;
+  }
+
+private:
+  std::array<int,num_events> fds;
+};
+
+template<typename F>
+perf_counters::result_type measure_counters(F f)
+{
+  using namespace std::chrono;
+
+  static const milliseconds min_time(200);
+  perf_counters             pc; /* counters are closed on return */
+  volatile decltype(f())    res; /* to avoid optimizing f() away */
+
+  int                               runs=0;
+  high_resolution_clock::time_point t1=high_resolution_clock::now(),t2;
+
+  pc.start();
+  do{
+    res=f();
+    ++runs;
+    t2=high_resolution_clock::now();
+  }while(t2-t1<min_time);
+  auto counts=pc.stop();
+  (void)res; /* var not used warn */
+
+  for(auto& c:counts)if(c>=0)c/=runs;
+  return counts;
+}
+
 #include <tuple>
 #include <utility>
 #include <boost/iterator/iterator_facade.hpp>
@@ -154,6 +285,7 @@ pointer<Class<Access>> make_pointer(const Access& a)
 } // namespace dod
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 using namespace dod;
@@ -299,6 +431,21 @@ int render(Iterator it,Size n)
 template<typename F>
 double measure(F f,std::size_t n){return (measure(f)/n)*10E6;}
 
+/* per-element counter values as ;-separated columns, n/a if unavailable */
+
+template<typename F>
+std::string counters(F f,std::size_t n)
+{
+  std::string res;
+  auto        counts=measure_counters(f);
+  for(int i=0;i<perf_counters::num_events;++i){
+    if(i)res+=";";
+    if(counts[i]<0)res+="n/a";
+    else           res+=std::to_string(counts[i]/n);
+  }
+  return res;
+}
+
 int main()
 {
   using color=member<char,0>;
@@ -310,7 +457,13 @@ int main()
   std::size_t n0=10000,n1=10000000,fn=10;
    
   std::cout<<"render:"<<std::endl;
-  std::cout<<"n;oop;raw;dod;render_dod;oop[i];raw[i];dod[i];render_dod[i]"<<std::endl;
+  std::cout<<"n;oop;raw;dod;render_dod;oop[i];raw[i];dod[i];render_dod[i]";
+  for(const char* impl:{"oop","raw","dod","render_dod"}){
+    for(int i=0;i<perf_counters::num_events;++i){
+      std::cout<<";"<<impl<<" "<<perf_counters::name(i);
+    }
+  }
+  std::cout<<std::endl;
    
   for(std::size_t n=n0;n<=n1;n*=fn){
     std::vector<char>           color_;
@@ -350,6 +503,10 @@ int main()
     std::cout<<measure([=](){return render(beg_oop,n);},n)<<";";
     std::cout<<measure([=](){return render(beg_color,beg_x,beg_y,n);},n)<<";";
     std::cout<<measure([=](){return render(beg_dod,n);},n)<<";";
-    std::cout<<measure([=](){return render(beg_rdod,n);},n)<<std::endl;
+    std::cout<<measure([=](){return render(beg_rdod,n);},n)<<";";
+    std::cout<<counters([=](){return render(beg_oop,end_oop);},n)<<";";
+    std::cout<<counters([=](){return render(beg_color,end_color,beg_x,beg_y);},n)<<";";
+    std::cout<<counters([=](){return render(beg_dod,end_dod);},n)<<";";
+    std::cout<<counters([=](){return render(beg_rdod,end_rdod);},n)<<std::endl;
   }
 }
@@ -52,6 +52,8 @@ void resume_timing()
   measure_start+=std::chrono::high_resolution_clock::now()-measure_pause;
 }
  
+#include <cstdint>
+#include <functional>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -116,6 +118,61 @@ private:
   std::ptrdiff_t distance_to(const access& x)const{return (p+off)-(x.p+x.off);}
 };
 
+/* tracked<Member> in an access list marks the element's chunk as dirty on
+ * every non-const get(Member), so that vector::for_each_dirty can later
+ * visit changed chunks only.
+ */
+
+template<typename Member>
+struct tracked
+{
+  using type=typename Member::type;
+};
+
+using dirty_word=std::uint64_t;
+static const std::size_t dirty_word_bits=64;
+static const std::size_t dirty_chunk_size=16; /* elements per dirty bit */
+
+inline void mark_dirty(dirty_word* d,std::size_t i)
+{
+  std::size_t c=i/dirty_chunk_size;
+  d[c/dirty_word_bits]|=dirty_word(1)<<(c%dirty_word_bits);
+}
+
+template<typename Member0,typename... Members>
+class access<tracked<Member0>,Members...>:
+  public access<Members...>
+{
+  using super=access<Members...>;
+  using type=typename Member0::type;
+ 
+  type*       p;
+  dirty_word* d;
+ 
+public:
+  template<typename... Args>
+  access(type* p,dirty_word* d,Args&&... args):
+    super(std::forward<Args>(args)...),p(p),d(d){}
+  access(const access& a,std::ptrdiff_t n):super(a,n),p(a.p),d(a.d){}
+ 
+  using super::get;
+ 
+  type&       get(Member0){mark_dirty(d,off);return p[off];}
+  const type& get(Member0)const{return p[off];}
+ 
+protected:
+  using super::off;
+ 
+private:
+  template<typename> friend class pointer;
+ 
+  bool equal(const access& x)const{return p+off==x.p+x.off;}
+  void increment(){++off;}
+  void decrement(){--off;}
+  void advance(std::ptrdiff_t n){off+=n;}
+  std::ptrdiff_t distance_to(const access& x)const{return (p+off)-(x.p+x.off);}
+};
+
 template<typename T> class pointer;
  
 template<template <typename> class Class,typename Access>
@@ -160,9 +217,16 @@ class vector_base;
 template<>
 class vector_base<access<>>
 {
+  struct innaccessible{};
+
 protected:
   access<> data(){return {};}
   void emplace_back(){}
+  template<typename Index> void permute(const Index&){}
+  void collect_dirty(std::vector<dirty_word>&)const{}
+  void clear_dirty(){}
+
+  void column(innaccessible)const;
 };
 
 template<typename Member0,typename... Members>
@@ -190,6 +254,86 @@ protected:
       throw;
     }
   }
+
+  using super::column;
+
+  const impl& column(Member0)const{return v;}
+
+  /* v[i] <- old v[idx[i]], gathered column by column */
+
+  template<typename Index>
+  void permute(const Index& idx){
+    impl w;
+    w.reserve(v.size());
+    for(auto i:idx)w.push_back(std::move(v[i]));
+    v.swap(w);
+    super::permute(idx);
+  }
+};
+
+template<typename Member0,typename... Members>
+class vector_base<access<tracked<Member0>,Members...>>:
+  protected vector_base<access<Members...>>
+{
+  using super=vector_base<access<Members...>>;
+  using type=typename Member0::type;
+  using impl=std::vector<type>;
+  using size_type=typename impl::size_type;
+  impl                    v;
+  std::vector<dirty_word> dirty;
+
+  static size_type num_words(size_type n)
+  {
+    size_type bits=dirty_chunk_size*dirty_word_bits;
+    return (n+bits-1)/bits;
+  }
+  
+protected:
+  access<tracked<Member0>,Members...> data()
+  {
+    return {v.data(),dirty.data(),super::data()};
+  }
+  size_type size()const{return v.size();}
+
+  template<typename Arg0,typename... Args>
+  void emplace_back(Arg0&& arg0,Args&&... args){
+    dirty.resize(num_words(v.size()+1));
+    v.emplace_back(std::forward<Arg0>(arg0));
+    try{
+      super::emplace_back(std::forward<Args>(args)...);
+    }
+    catch(...){
+      v.pop_back();
+      throw;
+    }
+    mark_dirty(dirty.data(),v.size()-1);
+  }
+
+  using super::column;
+
+  const impl& column(Member0)const{return v;}
+
+  template<typename Index>
+  void permute(const Index& idx){
+    impl w;
+    w.reserve(v.size());
+    for(auto i:idx)w.push_back(std::move(v[i]));
+    v.swap(w);
+    std::fill(dirty.begin(),dirty.end(),~dirty_word(0));
+    super::permute(idx);
+  }
+
+  void collect_dirty(std::vector<dirty_word>& mask)const
+  {
+    for(size_type i=0;i<dirty.size();++i)mask[i]|=dirty[i];
+    super::collect_dirty(mask);
+  }
+
+  void clear_dirty()
+  {
+    std::fill(dirty.begin(),dirty.end(),dirty_word(0));
+    super::clear_dirty();
+  }
 };
   
 template<typename T> class vector;
@@ -204,12 +348,85 @@ public:
   
   iterator begin(){return super::data();}
   iterator end(){return this->begin()+super::size();}
+  using super::size;
   using super::emplace_back;
+  using super::column;
+  using super::permute;
+  using super::clear_dirty;
+
+  /* visits the elements of every chunk written to through a tracked member
+   * since the last clear_dirty()
+   */
+
+  template<typename F>
+  void for_each_dirty(F f)
+  {
+    auto                    n=size();
+    std::vector<dirty_word> mask(
+      (n+dirty_chunk_size*dirty_word_bits-1)/(dirty_chunk_size*dirty_word_bits));
+    super::collect_dirty(mask);
+
+    iterator it=begin();
+    for(std::size_t i=0;i<mask.size();++i){
+      std::size_t c=i*dirty_word_bits;
+      for(dirty_word m=mask[i];m;m>>=1,++c){
+        if(!(m&1))continue;
+        std::size_t first=c*dirty_chunk_size,
+                    last=std::min<std::size_t>(first+dirty_chunk_size,n);
+        for(;first!=last;++first)f(it[first]);
+      }
+    }
+  }
 };
 
+/* Reordering through pointer's proxy Class<Access> is impractical, so
+ * sort_by/partition_by compute one index permutation from the key column and
+ * then apply it to each column in turn.
+ */
+
+template<
+  typename Member,typename Vector,
+  typename Compare=std::less<typename Member::type>
+>
+void sort_by(Vector& v,Compare comp=Compare())
+{
+  using type=typename Member::type;
+  using size_type=decltype(v.size());
+
+  const auto&                             c=v.column(Member());
+  std::vector<std::pair<type,size_type>> keys;
+  keys.reserve(c.size());
+  for(size_type i=0;i<c.size();++i)keys.emplace_back(c[i],i);
+  std::sort(
+    keys.begin(),keys.end(),
+    [&](const std::pair<type,size_type>& x,const std::pair<type,size_type>& y)
+      {return comp(x.first,y.first);});
+
+  std::vector<size_type> idx;
+  idx.reserve(keys.size());
+  for(const auto& k:keys)idx.push_back(k.second);
+  v.permute(idx);
+}
+
+template<typename Member,typename Vector,typename Predicate>
+auto partition_by(Vector& v,Predicate pred)->decltype(v.begin())
+{
+  using size_type=decltype(v.size());
+
+  const auto&            c=v.column(Member());
+  std::vector<size_type> idx;
+  idx.reserve(c.size());
+  for(size_type i=0;i<c.size();++i)if(pred(c[i]))idx.push_back(i);
+  size_type m=idx.size();
+  for(size_type i=0;i<c.size();++i)if(!pred(c[i]))idx.push_back(i);
+  v.permute(idx);
+  return v.begin()+m;
+}
+
 } // namespace dod
  
 #include <iostream>
+#include <random>
 #include <vector>
  
 using namespace dod;
@@ -237,6 +454,8 @@ public:
     color(color_),x(x_),y(y_),dx(dx_),dy(dy_)
   {}
  
+  int get_x()const{return x;}
+
   void render()const
   {
     do_render(x,y,color);
@@ -330,6 +549,20 @@ int render(Iterator first,Iterator last)
   return render_output;
 }
 
+struct render_element
+{
+  template<typename Particle>
+  void operator()(const Particle& p)const{p.render();}
+};
+
+template<typename Vector>
+int render_dirty(Vector& v)
+{
+  render_output=0;
+  v.for_each_dirty(render_element());
+  return render_output;
+}
+
 template<typename F>
 double measure(F f,std::size_t n){return (measure(f)/n)*10E6;}
  
@@ -363,4 +596,82 @@ int main()
     std::cout<<measure([&](){return render(pp_.begin(),pp_.end());},n)<<";";
     std::cout<<measure([&](){return render(p_.begin(),p_.end());},n)<<"\n";
   }
+
+  std::cout<<"sort by x:"<<std::endl;
+  std::cout<<"n;oop;dod"<<std::endl;
+
+  for(std::size_t n=n0;n<=n1;n*=fn){
+    using access=dod::access<color,x,y,dx,dy>;
+
+    std::vector<plain_particle>        pp_,pp;
+    dod::vector<particle<access>>      p_,p;
+    std::mt19937                       gen(34862);
+    std::uniform_int_distribution<int> dist(0,plain_particle::max_x);
+ 
+    for(std::size_t i=0;i<n;++i){
+      char carg=i%5;
+      int  xarg=dist(gen),yarg=2*i,dxarg=i%20,dyarg=i%10;
+      pp_.push_back(plain_particle(carg,xarg,yarg,dxarg,dyarg));
+      p_.emplace_back(carg,xarg,yarg,dxarg,dyarg);
+    }
+
+    std::cout<<n<<";";
+    std::cout<<measure([&](){
+      pause_timing();
+      pp=pp_;
+      resume_timing();
+      std::sort(
+        pp.begin(),pp.end(),
+        [](const plain_particle& x,const plain_particle& y)
+          {return x.get_x()<y.get_x();});
+      return pp.front().get_x();
+    },n)<<";";
+    std::cout<<measure([&](){
+      pause_timing();
+      p=p_;
+      resume_timing();
+      sort_by<x>(p);
+      return p.column(x()).front();
+    },n)<<"\n";
+  }
+
+  std::cout<<"render after mutation:"<<std::endl;
+  std::cout<<"n;mutation rate;dod;dod dirty"<<std::endl;
+
+  for(std::size_t n=n0;n<=n1;n*=fn){
+    using access=dod::access<color,tracked<x>,tracked<y>,dx,dy>;
+
+    dod::vector<particle<access>> p_;
+ 
+    for(std::size_t i=0;i<n;++i){
+      char carg=i%5;
+      int  xarg=i,yarg=2*i,dxarg=i%20,dyarg=i%10;
+      p_.emplace_back(carg,xarg,yarg,dxarg,dyarg);
+    }
+
+    for(double rate:{0.01,0.1,1.0}){
+      std::mt19937                     gen(34862);
+      std::bernoulli_distribution      dist(rate);
+      std::vector<std::size_t>         moved;
+      for(std::size_t i=0;i<n;++i)if(dist(gen))moved.push_back(i);
+
+      auto mutate=[&](){
+        pause_timing();
+        p_.clear_dirty();
+        auto it=p_.begin();
+        for(auto i:moved)it[i].move();
+        resume_timing();
+      };
+
+      std::cout<<n<<";"<<rate<<";";
+      std::cout<<measure([&](){
+        mutate();
+        return render(p_.begin(),p_.end());
+      },n)<<";";
+      std::cout<<measure([&](){
+        mutate();
+        return render_dirty(p_);
+      },n)<<"\n";
+    }
+  }
 }
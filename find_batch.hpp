@@ -0,0 +1,97 @@
+/* Batched lookup for unordered associative containers.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FIND_BATCH_HPP_9A41C3F6_CB52_11F1_B7C2_02FC00000001
+#define FIND_BATCH_HPP_9A41C3F6_CB52_11F1_B7C2_02FC00000001
+
+#include <algorithm>
+#include <cstddef>
+#include "flat_hash_set.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* find_batch(s,first,k,res) looks up keys [first,first+k) in s and stores
+ * the resulting iterators in res. With one key at a time, a lookup in a
+ * large container stalls on a cache miss per probe; batching lets those
+ * misses overlap.
+ *
+ * Node-based containers do not expose their bucket array, so the generic
+ * version works through the standard bucket interface: it first computes
+ * the bucket of every key (hashing only), then obtains the local begin of
+ * each bucket and prefetches the first node; finally each bucket is
+ * scanned with key_eq() and the element found is turned into an iterator
+ * with iterator_to. begin(b) is a synchronous load of the bucket entry, so
+ * only the node accesses are overlapped. This requires iterator_to, which
+ * multi_index hashed indices provide: std::unordered_set and
+ * boost::unordered_set are not supported, as their local iterators do not
+ * convert to iterators and resolving hits with find would hash and probe
+ * every key twice. flat_hash_set, whose layout is known, has its own
+ * find_batch prefetching the first probed group, and the overload below
+ * forwards to it.
+ */
+
+namespace find_batch_detail{
+
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__)
+  __builtin_prefetch(p);
+#elif defined(_MSC_VER)&&(defined(_M_X64)||defined(_M_IX86))
+  _mm_prefetch(static_cast<const char*>(p),_MM_HINT_T0);
+#else
+  (void)p;
+#endif
+}
+
+} //namespace find_batch_detail
+
+template<typename Container>
+void find_batch(
+  const Container& s,const typename Container::key_type* first,
+  std::size_t k,typename Container::const_iterator* res)
+{
+  typedef typename Container::size_type size_type;
+
+  static const std::size_t batch_max=64;
+  size_type                buckets[batch_max];
+  auto                     eq=s.key_eq();
+  auto                     end_=s.end();
+
+  while(k){
+    std::size_t m=std::min(k,batch_max);
+    for(std::size_t i=0;i<m;++i)buckets[i]=s.bucket(first[i]);
+    for(std::size_t i=0;i<m;++i){
+      auto it=s.begin(buckets[i]);
+      if(it!=s.end(buckets[i]))find_batch_detail::prefetch(&*it);
+    }
+    for(std::size_t i=0;i<m;++i){
+      auto it=s.begin(buckets[i]),it_end=s.end(buckets[i]);
+      while(it!=it_end&&!eq(*it,first[i]))++it;
+      res[i]=it!=it_end?s.iterator_to(*it):end_;
+    }
+    first+=m;
+    res+=m;
+    k-=m;
+  }
+}
+
+template<
+  typename T,typename Hash,typename Pred,typename Allocator,bool Unique
+>
+void find_batch(
+  const flat_hash_set_detail::table<T,Hash,Pred,Allocator,Unique>& s,
+  const T* first,std::size_t k,
+  typename flat_hash_set_detail::table<
+    T,Hash,Pred,Allocator,Unique>::const_iterator* res)
+{
+  s.find_batch(first,k,res);
+}
+
+#endif
@@ -0,0 +1,669 @@
+/* Open-addressing hash set with SIMD-probed metadata (Swiss table layout).
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FLAT_HASH_SET_HPP_F1377A68_CB2B_11F1_8A02_02FC00000001
+#define FLAT_HASH_SET_HPP_F1377A68_CB2B_11F1_8A02_02FC00000001
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <boost/functional/hash.hpp>
+
+#if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+#include <emmintrin.h>
+#define FLAT_HASH_SET_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Elements live in a single slot array split into groups of 16 slots. Each
+ * slot has a control byte: empty, deleted or, when full, the low 7 bits of
+ * the element hash (h2). A lookup visits groups in a quadratic sequence
+ * starting at the group selected by the remaining hash bits (h1), matches h2
+ * against the 16 control bytes of the group at once and compares only the
+ * slots that match; it stops at the first group with an empty slot.
+ */
+
+namespace flat_hash_set_detail{
+
+typedef signed char ctrl_t;
+
+static const ctrl_t ctrl_empty=-128;
+static const ctrl_t ctrl_deleted=-2;
+static const ctrl_t ctrl_sentinel=-1;
+
+inline bool is_full(ctrl_t c){return c>=0;}
+
+inline unsigned int countr_zero(unsigned int x)
+{
+#if defined(_MSC_VER)
+  unsigned long r;
+  _BitScanForward(&r,x);
+  return (unsigned int)r;
+#else
+  return (unsigned int)__builtin_ctz(x);
+#endif
+}
+
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__)
+  __builtin_prefetch(p);
+#elif defined(FLAT_HASH_SET_SSE2)
+  _mm_prefetch(static_cast<const char*>(p),_MM_HINT_T0);
+#else
+  (void)p;
+#endif
+}
+
+struct group
+{
+  static const std::size_t size=16;
+
+  explicit group(const ctrl_t* p)
+  {
+#if defined(FLAT_HASH_SET_SSE2)
+    ctrl=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+#else
+    std::copy(p,p+size,ctrl);
+#endif
+  }
+
+  /* bitmask of slots whose control byte is c */
+
+  unsigned int match(ctrl_t c)const
+  {
+#if defined(FLAT_HASH_SET_SSE2)
+    return (unsigned int)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(ctrl,_mm_set1_epi8(c)));
+#else
+    unsigned int res=0;
+    for(std::size_t i=0;i<size;++i)if(ctrl[i]==c)res|=1u<<i;
+    return res;
+#endif
+  }
+
+  unsigned int match_empty()const{return match(ctrl_empty);}
+
+  unsigned int match_empty_or_deleted()const
+  {
+#if defined(FLAT_HASH_SET_SSE2)
+    return (unsigned int)_mm_movemask_epi8(
+      _mm_cmplt_epi8(ctrl,_mm_set1_epi8(ctrl_sentinel)));
+#else
+    unsigned int res=0;
+    for(std::size_t i=0;i<size;++i)if(ctrl[i]<ctrl_sentinel)res|=1u<<i;
+    return res;
+#endif
+  }
+
+#if defined(FLAT_HASH_SET_SSE2)
+  __m128i ctrl;
+#else
+  ctrl_t  ctrl[size];
+#endif
+};
+
+/* Post-mixing of the user hash, as std::hash and boost::hash are the
+ * identity for integral types and h2 would only see the lowest bits.
+ */
+
+inline std::size_t mix(std::size_t h,std::integral_constant<int,8>)
+{
+  h*=0x9E3779B97F4A7C15ull;
+  return h^(h>>32);
+}
+
+inline std::size_t mix(std::size_t h,std::integral_constant<int,4>)
+{
+  h*=0x9E3779B9u;
+  return h^(h>>16);
+}
+
+inline std::size_t mix(std::size_t h)
+{
+  return mix(h,std::integral_constant<int,sizeof(std::size_t)>());
+}
+
+template<typename T>
+class iterator
+{
+public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef T                         value_type;
+  typedef std::ptrdiff_t            difference_type;
+  typedef const T*                  pointer;
+  typedef const T&                  reference;
+
+  iterator():pc(0),p(0){}
+  iterator(const ctrl_t* pc,const T* p):pc(pc),p(p){}
+
+  const T& operator*()const{return *p;}
+  const T* operator->()const{return p;}
+
+  iterator& operator++()
+  {
+    ++pc;
+    ++p;
+    skip();
+    return *this;
+  }
+
+  iterator operator++(int)
+  {
+    iterator tmp(*this);
+    ++*this;
+    return tmp;
+  }
+
+  friend bool operator==(const iterator& x,const iterator& y)
+  {
+    return x.p==y.p;
+  }
+
+  friend bool operator!=(const iterator& x,const iterator& y)
+  {
+    return x.p!=y.p;
+  }
+
+private:
+  template<typename,typename,typename,typename,bool> friend class table;
+
+  void skip(){while(*pc<ctrl_sentinel){++pc;++p;}}
+
+  const ctrl_t* pc;
+  const T*      p;
+};
+
+/* Result of erase(it): the iterator past the erased element is only looked
+ * for (skipping empty slots) if the result is actually converted, so that
+ * the usual s.erase(it) statement does not pay for the scan.
+ */
+
+template<typename T>
+class erase_return_type
+{
+public:
+  operator iterator<T>()const
+  {
+    iterator<T> res(it);
+    return ++res;
+  }
+
+private:
+  template<typename,typename,typename,typename,bool> friend class table;
+
+  explicit erase_return_type(const iterator<T>& it):it(it){}
+
+  iterator<T> it;
+};
+
+template<
+  typename T,typename Hash,typename Pred,typename Allocator,bool Unique
+>
+class table
+{
+  typedef typename std::aligned_storage<
+    sizeof(T),std::alignment_of<T>::value>::type   slot_type;
+  typedef std::allocator_traits<Allocator>          alloc_traits;
+  typedef typename alloc_traits::template
+    rebind_alloc<ctrl_t>                            ctrl_allocator;
+  typedef typename alloc_traits::template
+    rebind_alloc<slot_type>                         slot_allocator;
+
+public:
+  // types:
+
+  typedef T                                         key_type;
+  typedef T                                         value_type;
+  typedef Hash                                      hasher;
+  typedef Pred                                      key_equal;
+  typedef Allocator                                 allocator_type;
+  typedef const T&                                  reference;
+  typedef const T&                                  const_reference;
+  typedef std::size_t                               size_type;
+  typedef std::ptrdiff_t                            difference_type;
+  typedef flat_hash_set_detail::iterator<T>         iterator;
+  typedef iterator                                  const_iterator;
+  typedef typename std::conditional<
+    Unique,std::pair<iterator,bool>,iterator
+  >::type                                           insert_return_type;
+  typedef flat_hash_set_detail::erase_return_type<T>
+                                                    erase_return_type;
+
+  /* Elements equal to a given key are not adjacent in iteration order, so
+   * equal_range returns iterators of their own that follow the probe
+   * sequence of the key and stop at its matches.
+   */
+
+  class equal_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T                         value_type;
+    typedef std::ptrdiff_t            difference_type;
+    typedef const T*                  pointer;
+    typedef const T&                  reference;
+
+    equal_iterator():
+      t(0),x(),h2(0),mask(0),pos(0),step(0),m(0),last(true),p(0){}
+
+    const T& operator*()const{return *p;}
+    const T* operator->()const{return p;}
+
+    equal_iterator& operator++()
+    {
+      m&=m-1;
+      next();
+      return *this;
+    }
+
+    equal_iterator operator++(int)
+    {
+      equal_iterator tmp(*this);
+      ++*this;
+      return tmp;
+    }
+
+    friend bool operator==(const equal_iterator& x,const equal_iterator& y)
+    {
+      return x.p==y.p;
+    }
+
+    friend bool operator!=(const equal_iterator& x,const equal_iterator& y)
+    {
+      return x.p!=y.p;
+    }
+
+  private:
+    friend class table;
+
+    equal_iterator(const table* t,const T& x,std::size_t hash):
+      t(t),x(x),h2(ctrl_t(hash&0x7F)),
+      mask(t->capacity/group::size-1),pos((hash>>7)&mask),step(1),p(0)
+    {
+      load();
+      next();
+    }
+
+    void load()
+    {
+      group g(t->ctrl+pos*group::size);
+      m=g.match(h2);
+      last=g.match_empty()!=0;
+    }
+
+    /* first match at or after the lowest bit of m */
+
+    void next()
+    {
+      for(;;){
+        for(;m;m&=m-1){
+          size_type i=pos*group::size+countr_zero(m);
+          if(t->pred(*t->element(i),x)){
+            p=t->element(i);
+            return;
+          }
+        }
+        if(last){
+          p=0;
+          return;
+        }
+        pos=(pos+step++)&mask;
+        load();
+      }
+    }
+
+    const table* t;
+    T            x;
+    ctrl_t       h2;
+    size_type    mask,pos,step;
+    unsigned int m;
+    bool         last;
+    const T*     p;
+  };
+
+  // construct/copy/destroy:
+
+  explicit table(
+    const Hash& h=Hash(),const Pred& pred=Pred(),
+    const Allocator& al=Allocator()):
+    h(h),pred(pred),al(al),ctrl(empty_ctrl()),slots(0),
+    capacity(0),size_(0),deleted(0),max_load(0),mlf(0.875f){}
+
+  table(const table& x):
+    h(x.h),pred(x.pred),
+    al(alloc_traits::select_on_container_copy_construction(x.al)),
+    ctrl(empty_ctrl()),slots(0),
+    capacity(0),size_(0),deleted(0),max_load(0),mlf(x.mlf)
+  {
+    reserve(x.size_);
+    for(const T& v:x)insert_new(v);
+  }
+
+  table(table&& x):
+    h(x.h),pred(x.pred),al(x.al),ctrl(empty_ctrl()),slots(0),
+    capacity(0),size_(0),deleted(0),max_load(0),mlf(x.mlf)
+  {
+    swap(x);
+  }
+
+  ~table()
+  {
+    destroy();
+  }
+
+  table& operator=(table x)
+  {
+    swap(x);
+    return *this;
+  }
+
+  void swap(table& x)
+  {
+    std::swap(h,x.h);
+    std::swap(pred,x.pred);
+    std::swap(al,x.al);
+    std::swap(ctrl,x.ctrl);
+    std::swap(slots,x.slots);
+    std::swap(capacity,x.capacity);
+    std::swap(size_,x.size_);
+    std::swap(deleted,x.deleted);
+    std::swap(max_load,x.max_load);
+    std::swap(mlf,x.mlf);
+  }
+
+  allocator_type get_allocator()const{return al;}
+
+  // iterators:
+
+  const_iterator begin()const
+  {
+    const_iterator it(ctrl,element(0));
+    it.skip();
+    return it;
+  }
+
+  const_iterator end()const
+  {
+    return const_iterator(ctrl+capacity,element(capacity));
+  }
+
+  // capacity:
+
+  bool      empty()const{return size_==0;}
+  size_type size()const{return size_;}
+
+  // modifiers:
+
+  insert_return_type insert(const T& x)
+  {
+    return insert(x,std::integral_constant<bool,Unique>());
+  }
+
+  erase_return_type erase(const_iterator it)
+  {
+    size_type i=size_type(it.pc-ctrl);
+    element(i)->~T();
+    --size_;
+
+    /* a probe only goes past a group with no empty slots, so if this one
+     * still has one no lookup depends on the slot staying occupied
+     */
+
+    size_type g=i&~(group::size-1);
+    if(group(ctrl+g).match_empty())set_ctrl(i,ctrl_empty);
+    else{
+      set_ctrl(i,ctrl_deleted);
+      ++deleted;
+    }
+    return erase_return_type(it);
+  }
+
+  size_type erase(const T& x)
+  {
+    size_type res=0;
+    for(const_iterator it=find(x);it!=end();it=find(x)){
+      erase(it);
+      ++res;
+      if(Unique)break;
+    }
+    return res;
+  }
+
+  void clear()
+  {
+    for(size_type i=0;i<capacity;++i){
+      if(is_full(ctrl[i]))element(i)->~T();
+    }
+    std::fill(ctrl,ctrl+capacity,ctrl_empty);
+    size_=deleted=0;
+  }
+
+  // lookup:
+
+  const_iterator find(const T& x)const
+  {
+    if(!capacity)return end();
+    return find(x,mix(h(x)));
+  }
+
+  /* Looks up keys [first,first+k) and stores the results in res. Hashes
+   * are computed and the first group probed for each key is prefetched
+   * before any key is resolved, so that the cache misses of the batch
+   * overlap instead of being paid one after another.
+   */
+
+  void find_batch(const T* first,size_type k,const_iterator* res)const
+  {
+    static const size_type batch_max=64;
+    std::size_t            hashes[batch_max];
+
+    if(!capacity){
+      std::fill(res,res+k,end());
+      return;
+    }
+    size_type mask=capacity/group::size-1;
+    while(k){
+      size_type m=std::min(k,batch_max);
+      for(size_type i=0;i<m;++i){
+        hashes[i]=mix(h(first[i]));
+        size_type pos=((hashes[i]>>7)&mask)*group::size;
+        prefetch(ctrl+pos);
+        prefetch(element(pos));
+      }
+      for(size_type i=0;i<m;++i)res[i]=find(first[i],hashes[i]);
+      first+=m;
+      res+=m;
+      k-=m;
+    }
+  }
+
+  std::pair<equal_iterator,equal_iterator> equal_range(const T& x)const
+  {
+    if(!capacity)return std::make_pair(equal_iterator(),equal_iterator());
+    return std::make_pair(
+      equal_iterator(this,x,mix(h(x))),equal_iterator());
+  }
+
+  size_type count(const T& x)const
+  {
+    return count(x,std::integral_constant<bool,Unique>());
+  }
+
+  // hash policy:
+
+  size_type bucket_count()const{return capacity;}
+  float     load_factor()const{return capacity?float(size_)/capacity:0.0f;}
+  float     max_load_factor()const{return mlf;}
+
+  /* open addressing needs some slack: values above 7/8 are clamped */
+
+  void max_load_factor(float z)
+  {
+    mlf=std::max(0.125f,std::min(z,0.875f));
+    max_load=size_type(capacity*mlf);
+    if(size_+deleted>max_load)rehash(0);
+  }
+
+  void rehash(size_type n)
+  {
+    size_type new_capacity=group::size;
+    while(new_capacity<n||size_type(new_capacity*mlf)<size_){
+      new_capacity*=2;
+    }
+    if(new_capacity==capacity&&!deleted)return;
+
+    table x(h,pred,al);
+    x.mlf=mlf;
+    x.allocate(new_capacity);
+    for(size_type i=0;i<capacity;++i){
+      if(is_full(ctrl[i]))x.insert_new(std::move(*element(i)));
+    }
+    swap(x);
+  }
+
+  void reserve(size_type n)
+  {
+    rehash(size_type(double(n)/mlf)+1);
+  }
+
+private:
+  static ctrl_t* empty_ctrl()
+  {
+    static ctrl_t sentinel[1]={ctrl_sentinel};
+    return sentinel;
+  }
+
+  const_iterator find(const T& x,std::size_t hash)const
+  {
+    ctrl_t    h2=ctrl_t(hash&0x7F);
+    size_type mask=capacity/group::size-1,
+              pos=(hash>>7)&mask;
+    for(size_type step=1;;pos=(pos+step++)&mask){
+      group g(ctrl+pos*group::size);
+      for(unsigned int m=g.match(h2);m;m&=m-1){
+        size_type i=pos*group::size+countr_zero(m);
+        if(pred(*element(i),x))return const_iterator(ctrl+i,element(i));
+      }
+      if(g.match_empty())return end();
+    }
+  }
+
+  T*       element(size_type i)const{return reinterpret_cast<T*>(slots+i);}
+  void     set_ctrl(size_type i,ctrl_t c){ctrl[i]=c;}
+
+  void allocate(size_type n)
+  {
+    ctrl=ctrl_allocator(al).allocate(n+1);
+    std::fill(ctrl,ctrl+n,ctrl_empty);
+    ctrl[n]=ctrl_sentinel;
+    slots=slot_allocator(al).allocate(n);
+    capacity=n;
+    max_load=size_type(capacity*mlf);
+  }
+
+  void destroy()
+  {
+    if(!capacity)return;
+    for(size_type i=0;i<capacity;++i){
+      if(is_full(ctrl[i]))element(i)->~T();
+    }
+    ctrl_allocator(al).deallocate(ctrl,capacity+1);
+    slot_allocator(al).deallocate(slots,capacity);
+  }
+
+  size_type count(const T& x,std::true_type)const
+  {
+    return find(x)!=end()?1:0;
+  }
+
+  size_type count(const T& x,std::false_type)const
+  {
+    size_type res=0;
+    for(auto p=equal_range(x);p.first!=p.second;++p.first)++res;
+    return res;
+  }
+
+  std::pair<iterator,bool> insert(const T& x,std::true_type)
+  {
+    const_iterator it=find(x);
+    if(it!=end())return std::make_pair(it,false);
+    return std::make_pair(insert_new(x),true);
+  }
+
+  iterator insert(const T& x,std::false_type)
+  {
+    return insert_new(x);
+  }
+
+  /* insertion of an element known not to be present (or of a duplicate) */
+
+  template<typename Value>
+  iterator insert_new(Value&& x)
+  {
+    /* tombstones are dropped at the same capacity only if they take up a
+     * sizable share of the table, otherwise the table grows: rehashing in
+     * place with few of them would be repeated after a handful of erasures
+     * under an erase/insert mix near max load
+     */
+
+    if(size_+deleted+1>max_load){
+      rehash(
+        size_+1>max_load||deleted<capacity/16?capacity*2:capacity);
+    }
+    std::size_t hash=mix(h(x));
+    size_type   mask=capacity/group::size-1,
+                pos=(hash>>7)&mask;
+    for(size_type step=1;;pos=(pos+step++)&mask){
+      unsigned int m=group(ctrl+pos*group::size).match_empty_or_deleted();
+      if(m){
+        size_type i=pos*group::size+countr_zero(m);
+        ::new (static_cast<void*>(element(i))) T(std::forward<Value>(x));
+        if(ctrl[i]==ctrl_deleted)--deleted;
+        set_ctrl(i,ctrl_t(hash&0x7F));
+        ++size_;
+        return iterator(ctrl+i,element(i));
+      }
+    }
+  }
+
+  Hash       h;
+  Pred       pred;
+  Allocator  al;
+  ctrl_t*    ctrl;
+  slot_type* slots;
+  size_type  capacity,size_,deleted,max_load;
+  float      mlf;
+};
+
+} //namespace flat_hash_set_detail
+
+template<
+  typename T,typename Hash=boost::hash<T>,typename Pred=std::equal_to<T>,
+  typename Allocator=std::allocator<T>
+>
+using flat_hash_set=flat_hash_set_detail::table<T,Hash,Pred,Allocator,true>;
+
+template<
+  typename T,typename Hash=boost::hash<T>,typename Pred=std::equal_to<T>,
+  typename Allocator=std::allocator<T>
+>
+using flat_hash_multiset=
+  flat_hash_set_detail::table<T,Hash,Pred,Allocator,false>;
+
+#undef FLAT_HASH_SET_SSE2
+
+#endif
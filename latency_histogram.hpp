@@ -0,0 +1,238 @@
+/* Per-operation latency histograms based on the CPU timestamp counter.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef LATENCY_HISTOGRAM_HPP_D3B7A0E2_CB61_11F1_9C25_02FC00000001
+#define LATENCY_HISTOGRAM_HPP_D3B7A0E2_CB61_11F1_9C25_02FC00000001
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LATENCY_HISTOGRAM_RDTSC
+#elif defined(__x86_64__)||defined(__i386__)
+#include <x86intrin.h>
+#define LATENCY_HISTOGRAM_RDTSC
+#endif
+
+/* Averages hide the operations that take much longer than the rest, such
+ * as an insertion triggering a rehash. In latency mode (--mode=latency) the
+ * unordered benchmarks time every single operation and record it in a
+ * histogram with log-linear buckets, HdrHistogram style: values below 64
+ * are exact and every power-of-two range above is split in 32 buckets, so
+ * any value is known to within 1/32 of itself. Percentiles are reported as
+ * the upper end of the bucket they fall in, in nanoseconds.
+ *
+ * Timestamps come from rdtsc where available, converted to nanoseconds
+ * with a frequency calibrated once against std::chrono::steady_clock;
+ * elsewhere steady_clock is used directly. An operation is timed as
+ * stop()-start(): start() is lfence;rdtsc and stop() rdtscp;lfence, so
+ * that the CPU does not move the timestamp reads into or out of the
+ * operation. The recorded values include this overhead (some tens of
+ * cycles).
+ */
+
+namespace latency{
+
+#if !defined(LATENCY_HISTOGRAM_RDTSC)
+inline std::uint64_t steady_ticks()
+{
+  return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+/* lfence;rdtsc;lfence: the read waits for earlier instructions and the
+ * timed operation does not start before it
+ */
+
+inline std::uint64_t start()
+{
+#if defined(LATENCY_HISTOGRAM_RDTSC)
+  _mm_lfence();
+  std::uint64_t res=__rdtsc();
+  _mm_lfence();
+  return res;
+#else
+  return steady_ticks();
+#endif
+}
+
+/* rdtscp;lfence: rdtscp waits for the timed operation to complete and
+ * the lfence keeps later instructions from starting before the read
+ */
+
+inline std::uint64_t stop()
+{
+#if defined(LATENCY_HISTOGRAM_RDTSC)
+  unsigned int  aux;
+  std::uint64_t res=__rdtscp(&aux);
+  _mm_lfence();
+  return res;
+#else
+  return steady_ticks();
+#endif
+}
+
+inline double ns_per_tick()
+{
+#if defined(LATENCY_HISTOGRAM_RDTSC)
+  static const double res=[]{
+    using namespace std::chrono;
+
+    steady_clock::time_point t0=steady_clock::now(),t1;
+    std::uint64_t            c0=start();
+    do{t1=steady_clock::now();}while(t1-t0<milliseconds(50));
+    std::uint64_t            c1=stop();
+    return duration_cast<duration<double,std::nano>>(t1-t0).count()/(c1-c0);
+  }();
+  return res;
+#else
+  return 1.0;
+#endif
+}
+
+class histogram
+{
+public:
+  histogram():counts(num_buckets,0),total(0),max_(0){}
+
+  void record(std::uint64_t v)
+  {
+    ++counts[bucket(v)];
+    ++total;
+    max_=(std::max)(max_,v);
+  }
+
+  std::uint64_t count()const{return total;}
+  std::uint64_t max()const{return max_;}
+
+  /* smallest recorded value v such that a fraction q of records is <=v,
+   * up to bucket precision
+   */
+
+  std::uint64_t percentile(double q)const
+  {
+    if(!total)return 0;
+    std::uint64_t rank=(std::uint64_t)(q*total+0.5);
+    if(rank<1)rank=1;
+    std::uint64_t acc=0;
+    for(std::size_t i=0;i<num_buckets;++i){
+      acc+=counts[i];
+      if(acc>=rank)return (std::min)(upper_bound(i),max_);
+    }
+    return max_;
+  }
+
+private:
+  static const unsigned int sub_bits=6;
+  static const std::size_t  sub_count=std::size_t(1)<<sub_bits,
+                            half_count=sub_count/2,
+                            num_buckets=
+                              sub_count+(64-sub_bits)*half_count;
+
+  static unsigned int msb(std::uint64_t v)
+  {
+    unsigned int res=0;
+    while(v>>=1)++res;
+    return res;
+  }
+
+  /* v<64 maps to itself; otherwise the 5 bits below the most significant
+   * one select one of 32 buckets within v's power of two
+   */
+
+  static std::size_t bucket(std::uint64_t v)
+  {
+    if(v<sub_count)return std::size_t(v);
+    unsigned int shift=msb(v)-sub_bits+1;
+    return sub_count+(shift-1)*half_count+
+      std::size_t((v>>shift)-half_count);
+  }
+
+  static std::uint64_t upper_bound(std::size_t i)
+  {
+    if(i<sub_count)return i;
+    std::size_t  j=i-sub_count;
+    unsigned int shift=(unsigned int)(j/half_count)+1;
+    return ((std::uint64_t(j%half_count+half_count)+1)<<shift)-1;
+  }
+
+  std::vector<std::uint64_t> counts;
+  std::uint64_t              total,max_;
+};
+
+/* A latency runner performs n operations of some kind on a container and
+ * returns the histogram of their durations in ticks.
+ */
+
+typedef std::function<histogram(unsigned int)> runner;
+
+/* Emits a table with p50, p99, p99.9 and max in nanoseconds for every
+ * runner. Each repetition runs the operations anew; the four columns of a
+ * runner for a given size and repetition come from the same histogram.
+ */
+
+inline void test(
+  bench::session& s,const std::string& title,
+  const std::vector<std::string>& names,const std::vector<runner>& runners)
+{
+  /* histograms of the repetitions done so far for size n; a column asking
+   * for one more than there are triggers a new run
+   */
+
+  struct cache
+  {
+    runner                 r;
+    unsigned int           n;
+    std::vector<histogram> hs;
+    std::size_t            uses[4];
+
+    const histogram& get(unsigned int m,std::size_t column)
+    {
+      if(m!=n){
+        hs.clear();
+        std::fill(uses,uses+4,0);
+        n=m;
+      }
+      std::size_t rep=uses[column]++;
+      if(rep==hs.size())hs.push_back(r(m));
+      return hs[rep];
+    }
+  };
+
+  static const double stat_qs[]={0.5,0.99,0.999,1.0};
+  static const char*  stat_names[]={" p50"," p99"," p99.9"," max"};
+
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> table_runners;
+  for(std::size_t i=0;i<runners.size();++i){
+    std::shared_ptr<cache> c(new cache{runners[i],0,{},{0,0,0,0}});
+    for(std::size_t j=0;j<4;++j){
+      double q=stat_qs[j];
+      columns.push_back(names[i]+stat_names[j]);
+      table_runners.push_back([c,q,j](unsigned int n){
+        const histogram& h=c->get(n,j);
+        return ns_per_tick()*(q<1.0?h.percentile(q):h.max());
+      });
+    }
+  }
+  s.run(title+" latency (ns)",columns,table_runners,1.0);
+}
+
+} //namespace latency
+
+#undef LATENCY_HISTOGRAM_RDTSC
+
+#endif
@@ -53,9 +53,127 @@ void resume_timing()
 }
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <iostream>
 
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__)
+  __builtin_prefetch(p);
+#else
+  (void)p;
+#endif
+}
+
+/* number of trailing one bits of n */
+
+inline int trailing_ones(std::size_t n)
+{
+#if defined(__GNUC__)
+  return ~n?__builtin_ctzll(~(unsigned long long)n):(int)(8*sizeof(n));
+#else
+  int res=0;
+  for(;n&1;n>>=1)++res;
+  return res;
+#endif
+}
+
+/* floor(log2(n)), n non-null */
+
+inline int floor_log2(std::size_t n)
+{
+#if defined(__GNUC__)
+  return 63-__builtin_clzll((unsigned long long)n);
+#else
+  int res=0;
+  while(n>>=1)++res;
+  return res;
+#endif
+}
+
+/* On-disk format of a levelorder_vector: a 64-byte header followed by the
+ * level-order array as is, so that the file can be mapped and searched in
+ * place (see mapped_levelorder_vector).
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+struct levelorder_file_header
+{
+  static const std::uint32_t current_version=2;
+  static const std::uint32_t byte_order_mark=0x01020304;
+
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t element_size;
+  std::uint32_t element_kind; /* 1: unsigned, 2: signed, 3: floating point */
+  std::uint32_t byte_order;   /* byte_order_mark as written by the saver */
+  std::uint64_t size;
+  char          padding[32];
+
+  template<typename T>
+  static std::uint32_t kind()
+  {
+    return std::is_floating_point<T>::value?3:
+           std::is_signed<T>::value?2:1;
+  }
+
+  template<typename T>
+  static levelorder_file_header make(std::uint64_t size)
+  {
+    levelorder_file_header h;
+    std::memset(&h,0,sizeof(h));
+    std::memcpy(h.magic,"LVLORDER",8);
+    h.version=current_version;
+    h.byte_order=byte_order_mark;
+    h.element_size=sizeof(T);
+    h.element_kind=kind<T>();
+    h.size=size;
+    return h;
+  }
+
+  /* Throws if the header does not describe a file_size-byte file of Ts.
+   * size comes from the file, so it is compared against the room left by
+   * the header rather than multiplied, which could wrap around.
+   */
+
+  template<typename T>
+  void check(std::uint64_t file_size)const
+  {
+    if(file_size<sizeof(levelorder_file_header)){
+      throw std::runtime_error("levelorder_vector file too small");
+    }
+    if(std::memcmp(magic,"LVLORDER",8)!=0){
+      throw std::runtime_error("not a levelorder_vector file");
+    }
+    if(byte_order!=byte_order_mark){
+      throw std::runtime_error("levelorder_vector file byte order mismatch");
+    }
+    if(version!=current_version){
+      throw std::runtime_error("unsupported levelorder_vector file version");
+    }
+    if(element_size!=sizeof(T)||element_kind!=kind<T>()){
+      throw std::runtime_error("levelorder_vector file element type mismatch");
+    }
+    std::uint64_t room=file_size-sizeof(levelorder_file_header);
+    if(size>room/sizeof(T)||room!=size*sizeof(T)){
+      throw std::runtime_error("levelorder_vector file size mismatch");
+    }
+  }
+};
+
+static_assert(sizeof(levelorder_file_header)==64,"header must be 64 bytes");
+
+/* tag for constructing from an already sorted range */
+
+struct sorted_range_t{};
+const sorted_range_t sorted_range={};
+
 template<typename T>
 class levelorder_vector
 {
@@ -79,8 +197,15 @@ public:
   {
     vector aux(first,last);
     std::sort(aux.begin(),aux.end());
-    impl=aux;
-    insert(0,aux.size(),aux.begin());
+    impl.resize(aux.size());
+    fill(aux.begin());
+  }
+
+  template<typename ForwardIterator>
+  levelorder_vector(sorted_range_t,ForwardIterator first,ForwardIterator last):
+    impl(std::distance(first,last))
+  {
+    fill(first);
   }
   
   const_iterator begin()const{return impl.begin();}
@@ -111,33 +236,630 @@ public:
     }
     return begin()+i;
   }
+
+  const_iterator upper_bound(const T& x)const
+  {
+    size_type n=impl.size(),i=n,j=0;
+    while(j<n){
+      if(!(x<impl[j])){
+        j=2*j+2;
+      }
+      else{
+        i=j;
+        j=2*j+1;
+      }
+    }
+    return begin()+i;
+  }
+
+  /* Writes the level-order array with a levelorder_file_header; load reads
+   * it back without any reordering.
+   */
+
+  void save(const char* filename)const
+  {
+    static_assert(
+      std::is_arithmetic<T>::value,"only arithmetic types can be saved");
+
+    std::ofstream ofs(filename,std::ios::binary|std::ios::trunc);
+    auto          h=levelorder_file_header::make<T>(impl.size());
+    ofs.write(reinterpret_cast<const char*>(&h),sizeof(h));
+    ofs.write(
+      reinterpret_cast<const char*>(impl.data()),impl.size()*sizeof(T));
+    if(!ofs)throw std::runtime_error("error writing levelorder_vector file");
+  }
+
+  static levelorder_vector load(const char* filename)
+  {
+    static_assert(
+      std::is_arithmetic<T>::value,"only arithmetic types can be loaded");
+
+    std::ifstream ifs(filename,std::ios::binary|std::ios::ate);
+    if(!ifs)throw std::runtime_error("error opening levelorder_vector file");
+    std::uint64_t          file_size=ifs.tellg();
+    levelorder_file_header h;
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char*>(&h),sizeof(h));
+    if(!ifs)throw std::runtime_error("error reading levelorder_vector file");
+    h.check<T>(file_size);
+
+    levelorder_vector res;
+    res.impl.resize(h.size);
+    ifs.read(reinterpret_cast<char*>(res.impl.data()),h.size*sizeof(T));
+    if(!ifs)throw std::runtime_error("error reading levelorder_vector file");
+    return res;
+  }
+
+  /* Number of elements less than x. Subtree sizes in the complete tree are
+   * computed in O(1), so this is a single O(log n) descent.
+   */
+
+  size_type rank(const T& x)const
+  {
+    size_type n=impl.size(),r=0,k=1;
+    while(k<=n){
+      if(impl[k-1]<x){
+        r+=subtree_size(2*k,n)+1;
+        k=2*k+1;
+      }
+      else k=2*k;
+    }
+    return r;
+  }
+
+  /* number of elements in [a,b) */
+
+  size_type count_range(const T& a,const T& b)const
+  {
+    return a<b?rank(b)-rank(a):0;
+  }
+
+  /* visits the elements in sorted order */
+
+  template<typename F>
+  void for_each_in_order(F f)const
+  {
+    size_type n=impl.size();
+    if(!n)return;
+    const T* p=impl.data();
+    for(size_type k=leftmost(1,n);k;k=next_in_order(k,n))f(p[k-1]);
+  }
+
+  /* Same search with no data-dependent branch: k=j+1 (1-based index) records
+   * the path taken as a bit string, one bit per level (1 for right). The
+   * answer is the last node where we went left, obtained by dropping the
+   * trailing right turns plus that left turn. The 16 nodes four levels below
+   * are prefetched at each step.
+   */
+
+  const_iterator branchless_lower_bound(const T& x)const
+  {
+    size_type n=impl.size(),k=1;
+    const T*  p=impl.data();
+    while(k<=n){
+      prefetch(p+16*k-1);
+      k=2*k+(p[k-1]<x);
+    }
+    k>>=trailing_ones(k)+1;
+    return begin()+(k?k-1:n);
+  }
+
+  /* Searches in groups of batch_size keys walked in lock-step, one tree
+   * level at a time, so that the cache misses of independent descents
+   * overlap. Every level but the last is complete, hence all searches run
+   * the same number of unconditional steps.
+   */
+
+  static const std::size_t batch_size=16;
+
+  template<typename InputIterator,typename OutputIterator>
+  OutputIterator lower_bound_batch(
+    InputIterator first,InputIterator last,OutputIterator out)const
+  {
+    size_type n=impl.size(),levels=0;
+    const T*  p=impl.data();
+    while((size_type(2)<<levels)-1<=n)++levels;
+
+    while(first!=last){
+      T         keys[batch_size];
+      size_type k[batch_size],m=0;
+      for(;m<batch_size&&first!=last;++m,++first){
+        keys[m]=*first;
+        k[m]=1;
+      }
+      for(size_type l=0;l<levels;++l){
+        for(size_type i=0;i<m;++i){
+          k[i]=2*k[i]+(p[k[i]-1]<keys[i]);
+          prefetch(p+k[i]-1);
+        }
+      }
+      for(size_type i=0;i<m;++i){
+        if(k[i]<=n)k[i]=2*k[i]+(p[k[i]-1]<keys[i]);
+        k[i]>>=trailing_ones(k[i])+1;
+        *out++=begin()+(k[i]?k[i]-1:n);
+      }
+    }
+    return out;
+  }
   
 private:
-  void insert(size_type i,size_type n,const_iterator first)
+  /* number of nodes under 1-based node k (0 if k>n) */
+
+  static size_type subtree_size(size_type k,size_type n)
   {
-    if(n){
-      size_type h=root(n);
-      impl[i]=*(first+h);
-      insert(2*i+1,h,first);
-      insert(2*i+2,n-h-1,first+h+1);
-    }
+    if(k>n)return 0;
+    int       h=floor_log2(n)-floor_log2(k);
+    size_type first=k<<h,width=size_type(1)<<h;
+    return width-1+(first>n?0:std::min(n-first+1,width));
+  }
+
+  /* Assigns the sorted sequence at first to the nodes of the implicit tree
+   * in in-order, reading the input sequentially. Each successor step is
+   * O(1), so the whole fill is O(n) with no recursion.
+   */
+
+  template<typename InputIterator>
+  void fill(InputIterator first)
+  {
+    size_type n=impl.size();
+    if(!n)return;
+    for(size_type k=leftmost(1,n);k;k=next_in_order(k,n))impl[k-1]=*first++;
   }
 
-  size_type root(size_type n)
+  /* leftmost descendant of 1-based node k<=n */
+
+  static size_type leftmost(size_type k,size_type n)
+  {
+    k<<=floor_log2(n)-floor_log2(k);
+    return k<=n?k:k>>1;
+  }
+
+  /* in-order successor of 1-based node k, 0 if none: leftmost node of the
+   * right subtree or, failing that, the parent of the topmost ancestor
+   * reached through right-child links
+   */
+
+  static size_type next_in_order(size_type k,size_type n)
   {
-    if(n<=1)return 0;
-    size_type i=2;
-    while(i<=n)i*=2;
-    return std::min(i/2-1,n-i/4);
+    if(2*k+1<=n)return leftmost(2*k+1,n);
+    return k>>(trailing_ones(k)+1);
   }
   
   vector impl;
 };
 
+/* Read-only levelorder_vector over a memory-mapped file written by
+ * levelorder_vector::save: opening is O(1) and pages are brought in lazily
+ * as lookups touch them (the top levels of the tree first).
+ */
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+template<typename T>
+class mapped_levelorder_vector
+{
+  static_assert(
+    std::is_arithmetic<T>::value,"only arithmetic types can be mapped");
+
+public:
+  typedef T           value_type;
+  typedef const T&    const_reference;
+  typedef const T*    const_iterator;
+  typedef const T*    iterator;
+  typedef std::size_t size_type;
+
+  explicit mapped_levelorder_vector(const char* filename):
+    file(filename,boost::interprocess::read_only),
+    region(file,boost::interprocess::read_only)
+  {
+    if(region.get_size()<sizeof(levelorder_file_header)){
+      throw std::runtime_error("levelorder_vector file too small");
+    }
+    const auto& h=*static_cast<const levelorder_file_header*>(
+      region.get_address());
+    h.check<T>(region.get_size());
+    p=reinterpret_cast<const T*>(
+      static_cast<const char*>(region.get_address())+sizeof(h));
+    n=h.size;
+  }
+
+  const_iterator begin()const{return p;}
+  const_iterator end()const{return p+n;}
+  size_type      size()const{return n;}
+  bool           empty()const{return n==0;}
+
+  const_iterator lower_bound(const T& x)const
+  {
+    size_type i=n,j=0;
+    while(j<n){
+      if(p[j]<x){
+        j=2*j+2;
+      }
+      else{
+        i=j;
+        j=2*j+1;
+      }
+    }
+    return p+i;
+  }
+
+private:
+  boost::interprocess::file_mapping  file;
+  boost::interprocess::mapped_region region;
+  const T*                           p;
+  size_type                          n;
+};
+
+/* levelorder_vector augmented with the sum of each subtree (in level order
+ * as well), so that sums over [a,b) take two O(log n) descents. Sum should
+ * be wide enough to hold the total.
+ */
+
+template<typename T,typename Sum=T>
+class summed_levelorder_vector:public levelorder_vector<T>
+{
+  typedef levelorder_vector<T> super;
+
+public:
+  typedef typename super::size_type size_type;
+  typedef Sum                       sum_type;
+
+  summed_levelorder_vector(){}
+
+  template<typename InputIterator>
+  summed_levelorder_vector(InputIterator first,InputIterator last):
+    super(first,last)
+  {
+    size_type n=this->size();
+    const T*  p=data();
+    sums.resize(n);
+    for(size_type k=n;k>=1;--k){
+      sum_type s=p[k-1];
+      if(2*k<=n)  s+=sums[2*k-1];
+      if(2*k+1<=n)s+=sums[2*k];
+      sums[k-1]=s;
+    }
+  }
+
+  /* sum of elements less than x */
+
+  sum_type prefix_sum(const T& x)const
+  {
+    size_type n=this->size(),k=1;
+    const T*  p=data();
+    sum_type  s=0;
+    while(k<=n){
+      if(p[k-1]<x){
+        if(2*k<=n)s+=sums[2*k-1];
+        s+=p[k-1];
+        k=2*k+1;
+      }
+      else k=2*k;
+    }
+    return s;
+  }
+
+  /* sum of elements in [a,b) */
+
+  sum_type sum_range(const T& a,const T& b)const
+  {
+    return a<b?prefix_sum(b)-prefix_sum(a):sum_type(0);
+  }
+
+private:
+  const T* data()const{return this->empty()?nullptr:&*this->begin();}
+
+  std::vector<sum_type> sums;
+};
+
+/* Static B+-tree: the sorted elements form the leaf level, cut into nodes
+ * of B-1 keys each occupying one (64-byte aligned) cache line, and the last
+ * leaf is padded with copies of the maximum element. Above them, each
+ * internal level has a node of B-1 separator keys for every B nodes below,
+ * the i-th separator being the smallest key under child i+1. Internal
+ * levels are stored after the leaves, and node j of a level has children
+ * j*B,...,j*B+B-1 in the level below. Each search touches about
+ * log_B(n) cache lines, and as the leaves are the sorted sequence itself,
+ * [begin(),end()) traverses the elements in order.
+ */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <boost/align/aligned_allocator.hpp>
+
+/* number of keys in a sorted node less than x */
+
+template<typename T,std::size_t N>
+struct node_rank
+{
+  static std::size_t apply(const T* node,const T& x)
+  {
+    std::size_t res=0;
+    for(std::size_t i=0;i<N;++i)res+=(node[i]<x);
+    return res;
+  }
+};
+
+#if defined(__SSE2__)
+template<>
+struct node_rank<unsigned int,16>
+{
+  static std::size_t apply(const unsigned int* node,unsigned int x)
+  {
+    /* SSE2 only has signed comparison: flip the sign bits */
+
+    const __m128i bias=_mm_set1_epi32((int)0x80000000u),
+                  xv=_mm_xor_si128(_mm_set1_epi32((int)x),bias);
+    __m128i       acc=_mm_setzero_si128();
+    for(int i=0;i<16;i+=4){
+      __m128i v=_mm_xor_si128(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(node+i)),bias);
+      acc=_mm_sub_epi32(acc,_mm_cmpgt_epi32(xv,v));
+    }
+    acc=_mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(1,0,3,2)));
+    acc=_mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(2,3,0,1)));
+    return (std::size_t)_mm_cvtsi128_si32(acc);
+  }
+};
+#endif
+
+template<typename T,std::size_t B=64/sizeof(T)+1>
+class blocked_levelorder_vector
+{
+  static const std::size_t K=B-1; /* keys per node */
+  static_assert(K*sizeof(T)<=64,"node must fit in a cache line");
+
+  typedef std::vector<T,boost::alignment::aligned_allocator<T,64>> vector;
+  
+public:
+  typedef typename vector::value_type             value_type;
+  typedef typename vector::reference              reference;
+  typedef typename vector::const_reference        const_reference;
+  typedef typename vector::const_iterator         iterator;
+  typedef typename vector::const_iterator         const_iterator;
+  typedef typename vector::difference_type        difference_type;
+  typedef typename vector::size_type              size_type;
+  
+  blocked_levelorder_vector():n(0){}
+  
+  template<typename InputIterator>
+  blocked_levelorder_vector(InputIterator first,InputIterator last):
+    impl(first,last)
+  {
+    std::sort(impl.begin(),impl.end());
+    n=impl.size();
+    if(n)build();
+  }
+  
+  const_iterator begin()const{return impl.begin();}
+  const_iterator end()const{return impl.begin()+n;}
+  size_type      size()const{return n;}
+  bool           empty()const{return n==0;}
+  
+  const_iterator lower_bound(const T& x)const
+  {
+    if(!n||impl[n-1]<x)return end();
+    const T*  p=impl.data();
+    size_type j=0;
+    for(size_type l:levels)j=j*B+node_rank<T,K>::apply(p+l+j*K,x);
+    return begin()+(j*K+node_rank<T,K>::apply(p+j*K,x));
+  }
+  
+private:
+  /* smallest key under every node of the level below is kept in mins */
+
+  void build()
+  {
+    size_type      c=(n+K-1)/K; /* nodes in the level below */
+    std::vector<T> mins;
+    impl.resize(c*K,impl[n-1]);
+    for(size_type j=0;j<c;++j)mins.push_back(impl[j*K]);
+
+    std::vector<size_type> offsets;
+    while(c>1){
+      size_type      p=(c+B-1)/B,offset=impl.size();
+      std::vector<T> upper_mins;
+      offsets.push_back(offset);
+      impl.resize(offset+p*K,impl[n-1]);
+      for(size_type j=0;j<p;++j){
+        upper_mins.push_back(mins[j*B]);
+        for(size_type i=0;i<K&&j*B+i+1<c;++i){
+          impl[offset+j*K+i]=mins[j*B+i+1];
+        }
+      }
+      mins.swap(upper_mins);
+      c=p;
+    }
+    levels.assign(offsets.rbegin(),offsets.rend());
+  }
+
+  vector                 impl;   /* leaves, then internal levels bottom up */
+  size_type              n;
+  std::vector<size_type> levels; /* offsets of internal levels, top down */
+};
+
+/* Set (unique keys) on top of a levelorder_vector accepting a trickle of
+ * updates: insertions go to a small sorted delta and erasures of base
+ * elements to a set of tombstones, both consulted by lower_bound. When they
+ * grow past size()/pending_ratio, a merged levelorder_vector is built on a
+ * background thread from a snapshot of the delta and tombstones; updates
+ * made in the meantime are rebased onto the new base when it is picked up
+ * by the next modifying operation (or sync()).
+ * Iterators are plain pointers, with end() being null, and are invalidated
+ * by any modification.
+ */
+
+#include <boost/container/flat_set.hpp>
+#include <chrono>
+#include <future>
+#include <iterator>
+
+template<typename T>
+class dynamic_levelorder_vector
+{
+  typedef levelorder_vector<T>          base_type;
+  typedef boost::container::flat_set<T> delta_type;
+
+  static const std::size_t min_pending=1024,pending_ratio=64;
+
+public:
+  typedef T                             value_type;
+  typedef const T*                      const_iterator;
+  typedef const_iterator                iterator;
+  typedef std::size_t                   size_type;
+
+  dynamic_levelorder_vector(){}
+
+  template<typename InputIterator>
+  dynamic_levelorder_vector(InputIterator first,InputIterator last)
+  {
+    std::vector<T> aux(first,last);
+    std::sort(aux.begin(),aux.end());
+    aux.erase(std::unique(aux.begin(),aux.end()),aux.end());
+    base_type(sorted_range,aux.begin(),aux.end()).swap(base);
+  }
+
+  dynamic_levelorder_vector(const dynamic_levelorder_vector&)=delete;
+  dynamic_levelorder_vector& operator=(const dynamic_levelorder_vector&)=delete;
+
+  ~dynamic_levelorder_vector(){if(pending.valid())pending.wait();}
+
+  const_iterator end()const{return nullptr;}
+  size_type      size()const{return base.size()-tomb.size()+delta.size();}
+  bool           empty()const{return size()==0;}
+
+  const_iterator lower_bound(const T& x)const
+  {
+    const T* p=base_lower_bound(x);
+    auto     it=delta.lower_bound(x);
+    if(it!=delta.end()&&(!p||*it<*p))p=&*it;
+    return p;
+  }
+
+  bool insert(const T& x)
+  {
+    poll();
+    if(base_contains(x))return tomb.erase(x)!=0;
+    if(!delta.insert(x).second)return false;
+    maybe_rebuild();
+    return true;
+  }
+
+  bool erase(const T& x)
+  {
+    poll();
+    if(delta.erase(x))return true;
+    if(!base_contains(x)||!tomb.insert(x).second)return false;
+    maybe_rebuild();
+    return true;
+  }
+
+  /* waits for and installs any background rebuild in progress */
+
+  void sync()
+  {
+    if(pending.valid()){
+      pending.wait();
+      poll();
+    }
+  }
+
+private:
+  bool base_contains(const T& x)const
+  {
+    auto it=base.lower_bound(x);
+    return it!=base.end()&&!(x<*it);
+  }
+
+  const T* base_lower_bound(const T& x)const
+  {
+    auto it=base.lower_bound(x);
+    if(!tomb.empty()){
+      while(it!=base.end()&&tomb.count(*it))it=base.upper_bound(*it);
+    }
+    return it!=base.end()?&*it:nullptr;
+  }
+
+  void maybe_rebuild()
+  {
+    if(pending.valid()||
+       delta.size()+tomb.size()<=
+         std::max<size_type>(min_pending,base.size()/pending_ratio))return;
+
+    delta0=delta;
+    tomb0=tomb;
+    pending=std::async(
+      std::launch::async,&merge,
+      std::cref(base),std::cref(delta0),std::cref(tomb0));
+  }
+
+  /* With B'=(B-T0)+D0 the new base, current updates D,T are rebased as
+   * D'=(D-D0)+(T0-T) and T'=(T-T0)+(D0-D).
+   */
+
+  void poll()
+  {
+    if(!pending.valid()||
+       pending.wait_for(std::chrono::seconds(0))!=std::future_status::ready){
+      return;
+    }
+
+    base_type      b=pending.get();
+    std::vector<T> d1,d2,d,t1,t2,t;
+    std::set_difference(
+      delta.begin(),delta.end(),delta0.begin(),delta0.end(),
+      std::back_inserter(d1));
+    std::set_difference(
+      tomb0.begin(),tomb0.end(),tomb.begin(),tomb.end(),
+      std::back_inserter(d2));
+    std::merge(d1.begin(),d1.end(),d2.begin(),d2.end(),std::back_inserter(d));
+    std::set_difference(
+      tomb.begin(),tomb.end(),tomb0.begin(),tomb0.end(),
+      std::back_inserter(t1));
+    std::set_difference(
+      delta0.begin(),delta0.end(),delta.begin(),delta.end(),
+      std::back_inserter(t2));
+    std::merge(t1.begin(),t1.end(),t2.begin(),t2.end(),std::back_inserter(t));
+
+    base.swap(b);
+    delta_type(boost::container::ordered_unique_range,d.begin(),d.end()).
+      swap(delta);
+    delta_type(boost::container::ordered_unique_range,t.begin(),t.end()).
+      swap(tomb);
+    delta0.clear();
+    tomb0.clear();
+    maybe_rebuild();
+  }
+
+  static base_type merge(
+    const base_type& b,const delta_type& d,const delta_type& t)
+  {
+    std::vector<T> v;
+    v.reserve(b.size()-t.size()+d.size());
+    auto dit=d.begin(),tit=t.begin();
+    b.for_each_in_order([&](const T& x){
+      while(dit!=d.end()&&*dit<x)v.push_back(*dit++);
+      if(tit!=t.end()&&!(x<*tit))++tit; /* x is a tombstone */
+      else                       v.push_back(x);
+    });
+    v.insert(v.end(),dit,d.end());
+    return base_type(sorted_range,v.begin(),v.end());
+  }
+
+  base_type              base;
+  delta_type             delta,tomb;
+  delta_type             delta0,tomb0; /* snapshot being merged */
+  std::future<base_type> pending;
+};
+
 #include <iostream>
 #include <functional>
 #include <random>
+#include <string>
 #include <vector>
+#include "bench.hpp"
 
 struct rand_seq
 {
@@ -175,58 +897,387 @@ struct binary_search
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
-void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3)
+/* keys are drawn into a buffer in both versions so that only the search
+ * differs
+ */
+
+template<typename Container>
+struct batch_binary_search
 {
-  unsigned int n0=10000,n1=3000000,dn=2000;
-  double       fdn=1.2;
+  typedef unsigned int result_type;
  
-  std::cout<<title<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  unsigned int operator()(const Container & c)const
+  {
+    static const unsigned int batch=1024;
+
+    unsigned int              res=0;
+    unsigned int              n=c.size();
+    rand_seq                  rnd(c.size());
+    auto                      end_=c.end();
+    std::vector<unsigned int> keys(batch);
+    while(n){
+      unsigned int m=std::min(n,batch);
+      for(unsigned int i=0;i<m;++i)keys[i]=rnd();
+      for(unsigned int i=0;i<m;++i){
+        if(c.lower_bound(keys[i])!=end_)++res;
+      }
+      n-=m;
+    }
+    return res;
+  }
+};
+
+template<typename T>
+struct batch_binary_search<levelorder_vector<T>>
+{
+  typedef unsigned int result_type;
  
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
+  unsigned int operator()(const levelorder_vector<T> & c)const
+  {
+    static const unsigned int batch=1024;
+    typedef typename levelorder_vector<T>::const_iterator const_iterator;
 
-    {
-      auto c=create<Container1>(n);
-      t=measure(std::bind(Tester<Container1>(),std::cref(c)));
-      std::cout<<n<<";"<<(t/n)*10E6;
+    unsigned int                res=0;
+    unsigned int                n=c.size();
+    rand_seq                    rnd(c.size());
+    auto                        end_=c.end();
+    std::vector<unsigned int>   keys(batch);
+    std::vector<const_iterator> out(batch);
+    while(n){
+      unsigned int m=std::min(n,batch);
+      for(unsigned int i=0;i<m;++i)keys[i]=rnd();
+      c.lower_bound_batch(keys.begin(),keys.begin()+m,out.begin());
+      for(unsigned int i=0;i<m;++i){
+        if(out[i]!=end_)++res;
+      }
+      n-=m;
     }
+    return res;
+  }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n)
+{
+  auto c=create<Container>(n);
+  return measure(std::bind(Tester<Container>(),std::cref(c)))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  s.run(title,names,{bench::runner(&run<Tester,Containers>)...});
+}
+
+#include <cstdio>
+#include <set>
+
+std::vector<unsigned int> sorted_input(unsigned int n)
+{
+  std::vector<unsigned int> v;
+  for(unsigned int m=0;m<n;++m)v.push_back(m);
+  return v;
+}
+
+void test_construction(bench::session& s)
+{
+  s.run(
+    "Construction from sorted input",
     {
-      auto c=create<Container2>(n);
-      t=measure(std::bind(Tester<Container2>(),std::cref(c)));
-      std::cout<<";"<<(t/n)*10E6;
-    }
+      "std::set",
+      "boost::container::flat_set",
+      "levelorder_vector",
+      "levelorder_vector (sorted_range)"
+    },
+    {
+      [](unsigned int n){
+        auto v=sorted_input(n);
+        return measure([&](){
+          return std::set<unsigned int>(v.begin(),v.end()).size();
+        })/n;
+      },
+      [](unsigned int n){
+        auto v=sorted_input(n);
+        return measure([&](){
+          return boost::container::flat_set<unsigned int>(
+            boost::container::ordered_unique_range,v.begin(),v.end()).size();
+        })/n;
+      },
+      [](unsigned int n){
+        auto v=sorted_input(n);
+        return measure([&](){
+          return levelorder_vector<unsigned int>(v.begin(),v.end()).size();
+        })/n;
+      },
+      [](unsigned int n){
+        auto v=sorted_input(n);
+        return measure([&](){
+          return levelorder_vector<unsigned int>(
+            sorted_range,v.begin(),v.end()).size();
+        })/n;
+      }
+    });
+}
+
+void test_startup(bench::session& s)
+{
+  static const char* filename="levelorder_vector.bin";
+
+  auto save=[](unsigned int n){
+    auto v=sorted_input(n);
+    levelorder_vector<unsigned int>(sorted_range,v.begin(),v.end()).
+      save(filename);
+  };
+
+  s.run(
+    "Startup (construction/load/map plus one lookup)",
     {
-      auto c=create<Container3>(n);
-      t=measure(std::bind(Tester<Container3>(),std::cref(c)));
-      std::cout<<";"<<(t/n)*10E6<<std::endl;
+      "levelorder_vector (sorted_range)",
+      "levelorder_vector::load",
+      "mapped_levelorder_vector"
+    },
+    {
+      [](unsigned int n){
+        auto v=sorted_input(n);
+        return measure([&](){
+          levelorder_vector<unsigned int> c(sorted_range,v.begin(),v.end());
+          return *c.lower_bound(n/2);
+        })/n;
+      },
+      [&](unsigned int n){
+        save(n);
+        return measure([&](){
+          auto c=levelorder_vector<unsigned int>::load(filename);
+          return *c.lower_bound(n/2);
+        })/n;
+      },
+      [&](unsigned int n){
+        save(n);
+        return measure([&](){
+          mapped_levelorder_vector<unsigned int> c(filename);
+          return *c.lower_bound(n/2);
+        })/n;
+      }
+    });
+  std::remove(filename);
+}
+
+void test_range_queries(bench::session& s)
+{
+  typedef boost::container::flat_set<unsigned int>             container_t1;
+  typedef levelorder_vector<unsigned int>                      container_t2;
+  typedef summed_levelorder_vector<unsigned int,unsigned long> container_t3;
+
+  s.run(
+    "Range queries",
+    {
+      "boost::container::flat_set (count)",
+      "levelorder_vector (count_range)",
+      "summed_levelorder_vector (sum_range)"
+    },
+    {
+      [](unsigned int n){
+        auto c=create<container_t1>(n);
+        return measure([&](){
+          std::size_t res=0;
+          rand_seq    rnd(n);
+          for(unsigned int i=0;i<n;++i){
+            unsigned int a=rnd(),b=rnd();
+            if(b<a)std::swap(a,b);
+            res+=std::distance(c.lower_bound(a),c.lower_bound(b));
+          }
+          return res;
+        })/n;
+      },
+      [](unsigned int n){
+        auto c=create<container_t2>(n);
+        return measure([&](){
+          std::size_t res=0;
+          rand_seq    rnd(n);
+          for(unsigned int i=0;i<n;++i){
+            unsigned int a=rnd(),b=rnd();
+            if(b<a)std::swap(a,b);
+            res+=c.count_range(a,b);
+          }
+          return res;
+        })/n;
+      },
+      [](unsigned int n){
+        auto c=create<container_t3>(n);
+        return measure([&](){
+          unsigned long res=0;
+          rand_seq      rnd(n);
+          for(unsigned int i=0;i<n;++i){
+            unsigned int a=rnd(),b=rnd();
+            if(b<a)std::swap(a,b);
+            res+=c.sum_range(a,b);
+          }
+          return res;
+        })/n;
+      }
+    });
+}
+
+/* m erase+insert pairs */
+
+template<typename Container>
+void apply_updates(Container& c,unsigned int n,unsigned int m)
+{
+  rand_seq rnd(n);
+  for(unsigned int i=0;i<m;++i){
+    c.erase(rnd());
+    c.insert(n+rnd());
+  }
+}
+
+/* checks that c holds exactly the elements of ref */
+
+template<typename Container>
+void check_contents(const Container& c,const std::set<unsigned int>& ref)
+{
+  auto p=c.lower_bound(0);
+  for(unsigned int x:ref){
+    if(p==c.end()||*p!=x){
+      throw std::runtime_error("dynamic_levelorder_vector contents mismatch");
     }
+    p=c.lower_bound(x+1);
+  }
+  if(p!=c.end()||c.size()!=ref.size()){
+    throw std::runtime_error("dynamic_levelorder_vector contents mismatch");
   }
 }
 
-#include <boost/container/flat_set.hpp>
-#include <set>
+/* Replays the updates of the tables below on a dynamic_levelorder_vector
+ * and a std::set, checking return values and contents, the latter both
+ * with a merge possibly in flight and after sync(). Done once before
+ * timing, at a size where n/10 pairs trigger background rebuilds.
+ */
+
+void check_updates(unsigned int n)
+{
+  for(unsigned int m:{n/1000,n/10}){
+    auto                                    v=sorted_input(n);
+    dynamic_levelorder_vector<unsigned int> c(v.begin(),v.end());
+    std::set<unsigned int>                  ref(v.begin(),v.end());
+    rand_seq                                rnd(n);
+    for(unsigned int i=0;i<m;++i){
+      unsigned int x=rnd(),y=n+rnd();
+      if(c.erase(x)!=(ref.erase(x)!=0)||
+         c.insert(y)!=ref.insert(y).second){
+        throw std::runtime_error("dynamic_levelorder_vector update mismatch");
+      }
+    }
+    check_contents(c,ref);
+    c.sync();
+    check_contents(c,ref);
+  }
+}
+
+void test_updates(bench::session& s)
+{
+  typedef levelorder_vector<unsigned int>         container_t1;
+  typedef dynamic_levelorder_vector<unsigned int> container_t2;
+
+  check_updates(100000);
+
+  s.run(
+    "Binary search with n/1000 pending updates",
+    {"levelorder_vector","dynamic_levelorder_vector"},
+    {
+      &run<binary_search,container_t1>,
+      [](unsigned int n){
+        auto         v=sorted_input(n);
+        container_t2 c(v.begin(),v.end());
+        apply_updates(c,n,n/1000);
+        return measure(
+          std::bind(binary_search<container_t2>(),std::cref(c)))/n;
+      }
+    });
+
+  /* n/10 pairs exceed max(min_pending,n/pending_ratio) for every size
+   * tested, so background rebuilds are triggered and the updates following
+   * each trigger typically arrive while its merge is running
+   */
 
-int main()
+  s.run(
+    "Binary search after n/10 updates with background rebuilds",
+    {"levelorder_vector","dynamic_levelorder_vector"},
+    {
+      &run<binary_search,container_t1>,
+      [](unsigned int n){
+        auto         v=sorted_input(n);
+        container_t2 c(v.begin(),v.end());
+        apply_updates(c,n,n/10);
+        c.sync();
+        return measure(
+          std::bind(binary_search<container_t2>(),std::cref(c)))/n;
+      }
+    });
+}
+
+template<typename T>
+struct branchless_levelorder_vector:levelorder_vector<T>
+{
+  using levelorder_vector<T>::levelorder_vector;
+
+  typename levelorder_vector<T>::const_iterator lower_bound(const T& x)const
+  {
+    return this->branchless_lower_bound(x);
+  }
+};
+
+int main(int argc,char* argv[])
 {
-  typedef std::set<unsigned int>                   container_t1;
-  typedef boost::container::flat_set<unsigned int> container_t2;
-  typedef levelorder_vector<unsigned int>          container_t3;
+  typedef std::set<unsigned int>                     container_t1;
+  typedef boost::container::flat_set<unsigned int>   container_t2;
+  typedef levelorder_vector<unsigned int>            container_t3;
+  typedef branchless_levelorder_vector<unsigned int> container_t4;
+  typedef blocked_levelorder_vector<unsigned int>    container_t5;
+
+  bench::session s(
+    "levelorder_vector",argc,argv,{10000,3000000,2000,1.2});
  
   test<
     binary_search,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4,
+    container_t5>
   (
+    s,
     "Binary search",
-    "std::set",
-    "boost::container::flat_set",
-    "levelorder_vector"
+    {
+      "std::set",
+      "boost::container::flat_set",
+      "levelorder_vector",
+      "levelorder_vector (branchless)",
+      "blocked_levelorder_vector"
+    }
   );
+ 
+  test<
+    batch_binary_search,
+    container_t1,
+    container_t2,
+    container_t3,
+    container_t4,
+    container_t5>
+  (
+    s,
+    "Batched binary search",
+    {
+      "std::set",
+      "boost::container::flat_set",
+      "levelorder_vector (batched)",
+      "levelorder_vector (branchless)",
+      "blocked_levelorder_vector"
+    }
+  );
+
+  test_construction(s);
+  test_updates(s);
+  test_range_queries(s);
+  test_startup(s);
  }
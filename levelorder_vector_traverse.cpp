@@ -53,9 +53,37 @@ void resume_timing()
 }
  
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <iostream>
 #include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/permutation_iterator.hpp>
+
+/* number of trailing one bits of n */
+
+inline int trailing_ones(std::size_t n)
+{
+#if defined(__GNUC__)
+  return ~n?__builtin_ctzll(~(unsigned long long)n):(int)(8*sizeof(n));
+#else
+  int res=0;
+  for(;n&1;n>>=1)++res;
+  return res;
+#endif
+}
+
+/* floor(log2(n)), n non-null */
+
+inline int floor_log2(std::size_t n)
+{
+#if defined(__GNUC__)
+  return 63-__builtin_clzll((unsigned long long)n);
+#else
+  int res=0;
+  while(n>>=1)++res;
+  return res;
+#endif
+}
 
 template<typename T>
 class levelorder_vector
@@ -115,10 +143,22 @@ public:
   };
 
   typedef const_iterator iterator;
+
+  /* sorted traversal through the rank->index table, see build_rank_index */
+
+  typedef boost::permutation_iterator<
+    typename vector::const_iterator,
+    typename std::vector<size_type>::const_iterator
+  >                      ranked_iterator;
    
   levelorder_vector(){}
-  levelorder_vector(const levelorder_vector& x):impl(x.impl){}
-  levelorder_vector& operator=(const levelorder_vector& x){impl=x.impl;return *this;}
+  levelorder_vector(const levelorder_vector& x):impl(x.impl),ranks(x.ranks){}
+  levelorder_vector& operator=(const levelorder_vector& x)
+  {
+    impl=x.impl;
+    ranks=x.ranks;
+    return *this;
+  }
    
   template<typename InputIterator>
   levelorder_vector(InputIterator first,InputIterator last)
@@ -138,13 +178,68 @@ public:
                    {return x.impl==y.impl;}
   friend bool    operator!=(const levelorder_vector& x,const levelorder_vector& y)
                    {return x.impl!=y.impl;}
-  void           swap(levelorder_vector& x){impl.swap(x.impl);}
+  void           swap(levelorder_vector& x){impl.swap(x.impl);ranks.swap(x.ranks);}
   friend void    swap(levelorder_vector& x,levelorder_vector& y){x.swap(y);}
   size_type      size()const{return impl.size();}
   size_type      max_size()const{return impl.max_size();}
   bool           empty()const{return impl.empty();}
    
   const_iterator lower_bound(const T& x)const
+  {
+    return const_iterator(impl.data(),lower_bound_index(x),impl.size());
+  }
+
+  /* Range scans without iterators: successors are computed on the 1-based
+   * node index k in O(1) with bit operations, instead of climbing parent
+   * chains one level at a time.
+   */
+
+  template<typename F>
+  void for_each_in_order(F f)const
+  {
+    size_type n=impl.size();
+    if(!n)return;
+    const T* p=impl.data();
+    for(size_type k=leftmost(1,n);k;k=next_in_order(k,n))f(p[k-1]);
+  }
+
+  /* visits the elements in [lower,upper) in sorted order */
+
+  template<typename F>
+  void scan(const T& lower,const T& upper,F f)const
+  {
+    size_type n=impl.size(),k=lower_bound_index(lower)+1;
+    const T*  p=impl.data();
+    if(k>n)return;
+    for(;k&&p[k-1]<upper;k=next_in_order(k,n))f(p[k-1]);
+  }
+
+  /* Optional precomputed rank->index permutation making sorted traversal
+   * through ranked_begin()/ranked_end() a plain indirection per step. Costs
+   * one size_type per element and must be rebuilt if the container changes.
+   */
+
+  void build_rank_index()
+  {
+    size_type n=impl.size();
+    ranks.clear();
+    ranks.reserve(n);
+    if(!n)return;
+    for(size_type k=leftmost(1,n);k;k=next_in_order(k,n))ranks.push_back(k-1);
+  }
+
+  ranked_iterator ranked_begin()const
+  {
+    return boost::make_permutation_iterator(impl.begin(),ranks.begin());
+  }
+
+  ranked_iterator ranked_end()const
+  {
+    return boost::make_permutation_iterator(impl.begin(),ranks.end());
+  }
+   
+private:
+  size_type lower_bound_index(const T& x)const
   {
     size_type n=impl.size(),i=n,j=0;
     while(j<n){
@@ -156,10 +251,28 @@ public:
         j=2*j+1;
       }
     }
-    return const_iterator(impl.data(),i,impl.size());
+    return i;
   }
-   
-private:
+
+  /* leftmost descendant of 1-based node k<=n */
+
+  static size_type leftmost(size_type k,size_type n)
+  {
+    k<<=floor_log2(n)-floor_log2(k);
+    return k<=n?k:k>>1;
+  }
+
+  /* in-order successor of 1-based node k, 0 if none: leftmost node of the
+   * right subtree or, failing that, the parent of the topmost ancestor
+   * reached through right-child links
+   */
+
+  static size_type next_in_order(size_type k,size_type n)
+  {
+    if(2*k+1<=n)return leftmost(2*k+1,n);
+    return k>>(trailing_ones(k)+1);
+  }
+
   void insert(size_type i,size_type n,typename vector::const_iterator first)
   {
     if(n){
@@ -185,12 +298,15 @@ private:
     return a/2-1;
   }
 
-  vector impl;
+  vector                 impl;
+  std::vector<size_type> ranks;
 };
  
 #include <iostream>
 #include <functional>
+#include <string>
 #include <vector>
+#include "bench.hpp"
  
 template<typename Container>
 Container create(unsigned int n)
@@ -213,58 +329,93 @@ struct traverse
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
-void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3)
+template<typename T>
+struct in_order_levelorder_vector:levelorder_vector<T>
 {
-  unsigned int n0=10000,n1=3000000,dn=2000;
-  double       fdn=1.2;
+  using levelorder_vector<T>::levelorder_vector;
+};
+
+template<typename T>
+struct traverse<in_order_levelorder_vector<T>>
+{
+  typedef unsigned int result_type;
   
-  std::cout<<title<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  unsigned int operator()(const in_order_levelorder_vector<T> & c)const
+  {
+    unsigned int res=0;
+    c.for_each_in_order([&](const T& x){res+=x;});
+    return res;
+  }
+};
+
+template<typename T>
+struct ranked_levelorder_vector:levelorder_vector<T>
+{
+  template<typename InputIterator>
+  ranked_levelorder_vector(InputIterator first,InputIterator last):
+    levelorder_vector<T>(first,last)
+  {
+    this->build_rank_index();
+  }
+};
+
+template<typename T>
+struct traverse<ranked_levelorder_vector<T>>
+{
+  typedef unsigned int result_type;
   
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
- 
-    {
-      auto c=create<Container1>(n);
-      t=measure(std::bind(Tester<Container1>(),std::cref(c)));
-      std::cout<<n<<";"<<(t/n)*10E6;
-    }
-    {
-      auto c=create<Container2>(n);
-      t=measure(std::bind(Tester<Container2>(),std::cref(c)));
-      std::cout<<";"<<(t/n)*10E6;
-    }
-    {
-      auto c=create<Container3>(n);
-      t=measure(std::bind(Tester<Container3>(),std::cref(c)));
-      std::cout<<";"<<(t/n)*10E6<<std::endl;
-    }
+  unsigned int operator()(const ranked_levelorder_vector<T> & c)const
+  {
+    unsigned int res=0;
+    for(auto it=c.ranked_begin(),end=c.ranked_end();it!=end;++it)res+=*it;
+    return res;
   }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n)
+{
+  auto c=create<Container>(n);
+  return measure(std::bind(Tester<Container>(),std::cref(c)))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  s.run(title,names,{bench::runner(&run<Tester,Containers>)...});
 }
  
 #include <set>
 #include <boost/container/flat_set.hpp>
  
-int main()
+int main(int argc,char* argv[])
 {
   typedef std::set<unsigned int>                   container_t1;
   typedef boost::container::flat_set<unsigned int> container_t2;
   typedef levelorder_vector<unsigned int>          container_t3;
+  typedef in_order_levelorder_vector<unsigned int> container_t4;
+  typedef ranked_levelorder_vector<unsigned int>   container_t5;
+
+  bench::session s(
+    "levelorder_vector_traverse",argc,argv,{10000,3000000,2000,1.2});
   
   test<
     traverse,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4,
+    container_t5>
   (
+    s,
     "Traverse",
-    "std::set",
-    "boost::container::flat_set",
-    "levelorder_vector"
+    {
+      "std::set",
+      "boost::container::flat_set",
+      "levelorder_vector",
+      "levelorder_vector (for_each_in_order)",
+      "levelorder_vector (rank index)"
+    }
   );
 }
@@ -52,8 +52,18 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
+#include "counting_allocator.hpp"
 
 struct rand_seq
 {
@@ -66,6 +76,8 @@ struct rand_seq
     return m;
   }
 
+  void skip(unsigned int m){while(m--)dist(gen);}
+
 private:
   unsigned int                                mod;
   std::uniform_int_distribution<unsigned int> dist;
@@ -115,32 +127,285 @@ struct norehash_running_insertion
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
+/* Memory used by running insertion of n elements into a container with a
+ * counting_allocator: peak and final bytes per element and allocations per
+ * insert. This is not timed.
+ */
+
+struct memory_usage
+{
+  double peak_bytes,final_bytes,allocations;
+};
+
+template<typename Container>
+memory_usage insertion_memory(
+  unsigned int n,float Fmax,unsigned int G,bool norehash)
+{
+  reset_allocation_stats();
+  allocation_stats s0=get_allocation_stats(),s1;
+  {
+    Container s;
+    rand_seq  rnd(n,G);
+    s.max_load_factor(Fmax);
+    if(norehash)reserve(s,n);
+    for(unsigned int i=n;i--;)s.insert(rnd());
+    s1=get_allocation_stats();
+  }
+  memory_usage res={
+    double(s1.peak_bytes-s0.bytes)/n,double(s1.bytes-s0.bytes)/n,
+    double(s1.allocations)/n};
+  return res;
+}
+
+/* n insertions split among the threads, each taking its own stretch of
+ * the random sequence. Positioning the sequences and creating the threads
+ * is not timed.
+ */
+
+template<typename Container>
+struct parallel_running_insertion
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    unsigned int n,float Fmax,unsigned int G,unsigned int threads)const
+  {
+    unsigned int res=0;
+    {
+      Container s;
+      s.max_load_factor(Fmax);
+      pause_timing();
+      std::vector<rand_seq> rnds;
+      for(unsigned int t=0;t<threads;++t){
+        rnds.push_back(rand_seq(n,G));
+        rnds.back().skip((unsigned int)((unsigned long long)n*t/threads));
+      }
+
+      bench::start_gate        gate;
+      std::vector<std::thread> ths;
+      for(unsigned int t=0;t<threads;++t){
+        unsigned int m=(unsigned int)(
+          (unsigned long long)n*(t+1)/threads-
+          (unsigned long long)n*t/threads);
+        ths.emplace_back([&,t,m](){
+          rand_seq& rnd=rnds[t];
+          gate.wait();
+          for(unsigned int i=m;i--;)s.insert(rnd());
+        });
+      }
+      resume_timing();
+      gate.open();
+      for(auto& th:ths)th.join();
+      res=s.size();
+      pause_timing();
+    }
+    resume_timing();
+    return res;
+  }
+};
+
+template<typename Container>
+struct parallel_norehash_running_insertion
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    unsigned int n,float Fmax,unsigned int G,unsigned int threads)const
+  {
+    unsigned int res=0;
+    {
+      Container s;
+      s.max_load_factor(Fmax);
+      reserve(s,n);
+      pause_timing();
+      std::vector<rand_seq> rnds;
+      for(unsigned int t=0;t<threads;++t){
+        rnds.push_back(rand_seq(n,G));
+        rnds.back().skip((unsigned int)((unsigned long long)n*t/threads));
+      }
+
+      bench::start_gate        gate;
+      std::vector<std::thread> ths;
+      for(unsigned int t=0;t<threads;++t){
+        unsigned int m=(unsigned int)(
+          (unsigned long long)n*(t+1)/threads-
+          (unsigned long long)n*t/threads);
+        ths.emplace_back([&,t,m](){
+          rand_seq& rnd=rnds[t];
+          gate.wait();
+          for(unsigned int i=m;i--;)s.insert(rnd());
+        });
+      }
+      resume_timing();
+      gate.open();
+      for(auto& th:ths)th.join();
+      res=s.size();
+      pause_timing();
+    }
+    resume_timing();
+    return res;
+  }
+};
+
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct running_insertion_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n,float Fmax,unsigned int G)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n,G);
+    s.max_load_factor(Fmax);
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      s.insert(x);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<typename Container>
+struct norehash_running_insertion_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n,float Fmax,unsigned int G)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n,G);
+    s.max_load_factor(Fmax);
+    reserve(s,n);
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      s.insert(x);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n,float Fmax,unsigned int G)
+{
+  return measure(boost::bind(Tester<Container>(),n,Fmax,G))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
 void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3,
+  bench::session& s,const char* title,const std::vector<std::string>& names,
   float Fmax,unsigned int G)
 {
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  s.run(
+    os.str(),names,
+    {bench::runner(std::bind(
+      &run<Tester,Containers>,std::placeholders::_1,Fmax,G))...});
+}
+
+/* aggregate insertions/s */
+
+template<template<typename> class Tester,typename Container>
+double run_parallel(
+  unsigned int n,float Fmax,unsigned int G,unsigned int threads)
+{
+  unsigned int m=Tester<Container>()(n,Fmax,G,threads);
+  return m/measure(boost::bind(Tester<Container>(),n,Fmax,G,threads));
+}
+
+template<template<typename> class Tester,typename Container>
+void test_parallel(
+  bench::session& s,const char* title,const std::string& name,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream         os;
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  for(unsigned int t:bench::thread_counts(s.get_options())){
+    columns.push_back(name+" ("+bench::thread_label(t)+")");
+    runners.push_back(std::bind(
+      &run_parallel<Tester,Container>,std::placeholders::_1,Fmax,G,t));
+  }
+  s.run(os.str(),columns,runners,1.0);
+}
+
+/* peak/final bytes per element and allocations per insert by container.
+ * The three columns of a container come from a single insertion run per
+ * size; the figures are deterministic, so repetitions reuse it.
+ */
+
+template<typename... Containers>
+void test_memory(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G,bool norehash)
+{
+  typedef std::function<
+    memory_usage(unsigned int,float,unsigned int,bool)> memory_runner;
 
-  std::cout<<title<<", Fmax="<<Fmax<<", G="<<G<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  struct cache
+  {
+    memory_runner r;
+    float         Fmax;
+    unsigned int  G;
+    bool          norehash;
+    unsigned int  n;
+    memory_usage  u;
 
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
+    const memory_usage& get(unsigned int m)
+    {
+      if(m!=n){
+        u=r(m,Fmax,G,norehash);
+        n=m;
+      }
+      return u;
+    }
+  };
 
-    t=measure(boost::bind(Tester<Container1>(),n,Fmax,G));
-    std::cout<<n<<";"<<(t/n)*10E6;
+  static double memory_usage::* const stats[]={
+    &memory_usage::peak_bytes,&memory_usage::final_bytes,
+    &memory_usage::allocations};
+  static const char*                  stat_names[]={
+    " peak bytes/element"," final bytes/element"," allocations/insert"};
 
-    t=measure(boost::bind(Tester<Container2>(),n,Fmax,G));
-    std::cout<<";"<<(t/n)*10E6;
- 
-    t=measure(boost::bind(Tester<Container3>(),n,Fmax,G));
-    std::cout<<";"<<(t/n)*10E6<<std::endl;
+  std::vector<memory_runner> runs={
+    memory_runner(&insertion_memory<Containers>)...};
+
+  std::ostringstream         os;
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  for(std::size_t i=0;i<names.size();++i){
+    std::shared_ptr<cache> c(
+      new cache{runs[i],Fmax,G,norehash,0,memory_usage()});
+    for(std::size_t j=0;j<3;++j){
+      double memory_usage::* stat=stats[j];
+      columns.push_back(names[i]+stat_names[j]);
+      runners.push_back([c,stat](unsigned int n){return c->get(n).*stat;});
+    }
   }
+  s.run(os.str(),columns,runners,1.0);
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  latency::test(
+    s,os.str(),names,
+    {latency::runner(std::bind(
+      Tester<Containers>(),std::placeholders::_1,Fmax,G))...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -148,8 +413,10 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "concurrent_hash_set.hpp"
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -164,56 +431,235 @@ int main()
       hashed_non_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_multiset<unsigned int>        container_t4;
+  typedef concurrent_hash_multiset<unsigned int>  container_t5;
+
+  /* same containers with a counting_allocator, for memory usage */
+
+  typedef counting_allocator<unsigned int>        counting_alloc;
+  typedef std::unordered_multiset<
+    unsigned int,std::hash<unsigned int>,std::equal_to<unsigned int>,
+    counting_alloc
+  >                                               counted_t1;
+  typedef boost::unordered_multiset<
+    unsigned int,boost::hash<unsigned int>,std::equal_to<unsigned int>,
+    counting_alloc
+  >                                               counted_t2;
+  typedef boost::multi_index_container<
+    unsigned int,
+    indexed_by<
+      hashed_non_unique<identity<unsigned int> >
+    >,
+    counting_alloc
+  >                                               counted_t3;
+  typedef flat_hash_multiset<
+    unsigned int,boost::hash<unsigned int>,std::equal_to<unsigned int>,
+    counting_alloc
+  >                                               counted_t4;
+
+  bench::session s(
+    "non_unique_running_insertion",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      norehash_running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "No-rehash running insertion",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      1.0,5
+    );
+
+    test_latency<
+      norehash_running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "No-rehash running insertion",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      5.0,5
+    );
+
+    test_latency<
+      running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Running insertion",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      1.0,5
+    );
+
+    test_latency<
+      running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Running insertion",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      5.0,5
+    );
+    return 0;
+  }
 
   test<
     norehash_running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "No-rehash runnning insertion",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     1.0,5
   );
 
+  test_memory<counted_t1,counted_t2,counted_t3,counted_t4>(
+    s,
+    "No-rehash running insertion memory",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    1.0,5,true
+  );
+
   test<
     norehash_running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "No-rehash runnning insertion",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     5.0,5
   );
 
+  test_memory<counted_t1,counted_t2,counted_t3,counted_t4>(
+    s,
+    "No-rehash running insertion memory",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    5.0,5,true
+  );
+
    test<
     running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Runnning insertion",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     1.0,5
   );
 
+  test_memory<counted_t1,counted_t2,counted_t3,counted_t4>(
+    s,
+    "Running insertion memory",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    1.0,5,false
+  );
+
   test<
     running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Runnning insertion",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     5.0,5
   );
+
+  test_memory<counted_t1,counted_t2,counted_t3,counted_t4>(
+    s,
+    "Running insertion memory",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    5.0,5,false
+  );
+
+  test_parallel<parallel_norehash_running_insertion,container_t5>(
+    s,"Parallel no-rehash running insertion (insertions/s)",
+    "concurrent_hash_multiset",1.0,5);
+
+  test_parallel<parallel_running_insertion,container_t5>(
+    s,"Parallel running insertion (insertions/s)",
+    "concurrent_hash_multiset",1.0,5);
 }
@@ -52,9 +52,15 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <random>
+#include <sstream>
+#include <string>
 #include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
 
 struct rand_seq
 {
@@ -99,32 +105,64 @@ struct scattered_erasure
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
-void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3,
-  float Fmax,unsigned int G)
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct scattered_erasure_latency
 {
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
+  typedef latency::histogram result_type;
 
-  std::cout<<title<<", Fmax="<<Fmax<<", G="<<G<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  latency::histogram operator()(unsigned int n,float Fmax,unsigned int G)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n,G);
+    s.max_load_factor(Fmax);
+    for(unsigned int m=n;m--;)s.insert(rnd());
+    std::vector<typename Container::iterator> v;
+    v.reserve(s.size());
+    for(auto it=s.begin();it!=s.end();++it)v.push_back(it);
+    std::mt19937 gen(73642);
+    std::shuffle(v.begin(),v.end(),gen);
+    for(auto it:v){
+      std::uint64_t t0=latency::start();
+      s.erase(it);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
 
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n,float Fmax,unsigned int G)
+{
+  return measure(boost::bind(Tester<Container>(),n,Fmax,G))/n;
+}
 
-    t=measure(boost::bind(Tester<Container1>(),n,Fmax,G));
-    std::cout<<n<<";"<<(t/n)*10E6;
+template<template<typename> class Tester,typename... Containers>
+void test(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  s.run(
+    os.str(),names,
+    {bench::runner(std::bind(
+      &run<Tester,Containers>,std::placeholders::_1,Fmax,G))...});
+}
 
-    t=measure(boost::bind(Tester<Container2>(),n,Fmax,G));
-    std::cout<<";"<<(t/n)*10E6;
- 
-    t=measure(boost::bind(Tester<Container3>(),n,Fmax,G));
-    std::cout<<";"<<(t/n)*10E6<<std::endl;
-  }
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  latency::test(
+    s,os.str(),names,
+    {latency::runner(std::bind(
+      Tester<Containers>(),std::placeholders::_1,Fmax,G))...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -132,8 +170,9 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -148,17 +187,65 @@ int main()
       hashed_non_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_multiset<unsigned int>        container_t4;
+
+  bench::session s(
+    "non_unique_scattered_erasure",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      scattered_erasure_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered erasure",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      1.0,5
+    );
+
+    test_latency<
+      scattered_erasure_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered erasure",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      5.0,5
+    );
+    return 0;
+  }
 
   test<
     scattered_erasure,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered erasure",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     1.0,5
   );
 
@@ -166,12 +253,17 @@ int main()
     scattered_erasure,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered erasure",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     5.0,5
   );
 }
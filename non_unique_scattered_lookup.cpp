@@ -22,6 +22,7 @@ double measure(F f)
   static const int              num_trials=10;
   static const milliseconds     min_time_per_trial(200);
   std::array<double,num_trials> trials;
+  static decltype(f())          res; /* to avoid optimizing f() away */
 
   for(int i=0;i<num_trials;++i){
     int                               runs=0;
@@ -29,12 +30,13 @@ double measure(F f)
 
     measure_start=high_resolution_clock::now();
     do{
-      f();
+      res=f();
       ++runs;
       t2=high_resolution_clock::now();
     }while(t2-measure_start<min_time_per_trial);
     trials[i]=duration_cast<duration<double>>(t2-measure_start).count()/runs;
   }
+  (void)res; /* var not used warn */
 
   std::sort(trials.begin(),trials.end());
   return std::accumulate(
@@ -52,10 +54,17 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
 #include <boost/ref.hpp>
+#include <functional>
 #include <iostream>
 #include <random>
+#include <sstream>
+#include <string>
 #include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
+#include "find_batch.hpp"
 
 struct rand_seq
 {
@@ -121,38 +130,175 @@ struct scattered_unsuccessful_lookup
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
+/* Lookups in batches of K keys through find_batch. */
+
+template<typename Container>
+struct batch_successful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int G,unsigned int K)const
+  {
+    typedef typename Container::const_iterator const_iterator;
+
+    unsigned int                                res=0;
+    rand_seq                                    rnd(n,G);
+    std::vector<unsigned int>                   keys(K);
+    std::vector<const_iterator>                 its(K);
+    auto                                        end_=s.end();
+    while(n){
+      unsigned int m=std::min(n,K);
+      for(unsigned int i=0;i<m;++i)keys[i]=rnd();
+      find_batch(s,keys.data(),m,its.data());
+      for(unsigned int i=0;i<m;++i)if(its[i]!=end_)++res;
+      n-=m;
+    }
+    return res;
+  }
+};
+
+template<typename Container>
+struct batch_unsuccessful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int,unsigned int K)const
+  {
+    typedef typename Container::const_iterator const_iterator;
+
+    unsigned int                                res=0;
+    std::uniform_int_distribution<unsigned int> dist;
+    std::mt19937                                gen(76453);
+    std::vector<unsigned int>                   keys(K);
+    std::vector<const_iterator>                 its(K);
+    auto                                        end_=s.end();
+    while(n){
+      unsigned int m=std::min(n,K);
+      for(unsigned int i=0;i<m;++i)keys[i]=dist(gen);
+      find_batch(s,keys.data(),m,its.data());
+      for(unsigned int i=0;i<m;++i)if(its[i]!=end_)++res;
+      n-=m;
+    }
+    return res;
+  }
+};
+
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct scattered_successful_lookup_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n,float Fmax,unsigned int G)const
+  {
+    const Container                             s=create<Container>(n,Fmax,G);
+    latency::histogram                          h;
+    volatile unsigned int                       res=0;
+    rand_seq                                    rnd(n,G);
+    auto                                        end_=s.end();
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      if(s.find(x)!=end_)res=res+1;
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<typename Container>
+struct scattered_unsuccessful_lookup_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n,float Fmax,unsigned int G)const
+  {
+    const Container                             s=create<Container>(n,Fmax,G);
+    latency::histogram                          h;
+    volatile unsigned int                       res=0;
+    std::uniform_int_distribution<unsigned int> dist;
+    std::mt19937                                gen(76453);
+    auto                                        end_=s.end();
+    while(n--){
+      unsigned int  x=dist(gen);
+      std::uint64_t t0=latency::start();
+      if(s.find(x)!=end_)res=res+1;
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n,float Fmax,unsigned int G)
+{
+  const Container s=create<Container>(n,Fmax,G);
+  return measure(boost::bind(Tester<Container>(),boost::cref(s),n,G))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
 void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3,
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  s.run(
+    os.str(),names,
+    {bench::runner(std::bind(
+      &run<Tester,Containers>,std::placeholders::_1,Fmax,G))...});
+}
+
+/* one column per container and batch size */
+
+template<template<typename> class Tester,typename Container>
+double run_batch(unsigned int n,float Fmax,unsigned int G,unsigned int K)
+{
+  const Container s=create<Container>(n,Fmax,G);
+  return measure(boost::bind(Tester<Container>(),boost::cref(s),n,G,K))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_batch(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
   float Fmax,unsigned int G)
 {
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
-
-  std::cout<<title<<", Fmax="<<Fmax<<", G="<<G<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
-
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
-
-    t=measure(boost::bind(
-        Tester<Container1>(),
-        boost::cref(create<Container1>(n,Fmax,G)),n,G));
-    std::cout<<n<<";"<<(t/n)*10E6;
-
-    t=measure(boost::bind(
-      Tester<Container2>(),
-      boost::cref(create<Container2>(n,Fmax,G)),n,G));
-    std::cout<<";"<<(t/n)*10E6;
- 
-    t=measure(boost::bind(
-      Tester<Container3>(),
-      boost::cref(create<Container3>(n,Fmax,G)),n,G));
-    std::cout<<";"<<(t/n)*10E6<<std::endl;
+  typedef std::function<
+    double(unsigned int,float,unsigned int,unsigned int)> batch_runner;
+
+  static const unsigned int batch_sizes[]={1,2,4,8,16,32,64};
+
+  std::vector<batch_runner> runs={
+    batch_runner(&run_batch<Tester,Containers>)...};
+
+  std::ostringstream         os;
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  for(std::size_t i=0;i<names.size();++i){
+    for(unsigned int K:batch_sizes){
+      columns.push_back(names[i]+" (K="+std::to_string(K)+")");
+      runners.push_back(
+        std::bind(runs[i],std::placeholders::_1,Fmax,G,K));
+    }
   }
+  s.run(os.str(),columns,runners);
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names,
+  float Fmax,unsigned int G)
+{
+  std::ostringstream os;
+  os<<title<<", Fmax="<<Fmax<<", G="<<G;
+  latency::test(
+    s,os.str(),names,
+    {latency::runner(std::bind(
+      Tester<Containers>(),std::placeholders::_1,Fmax,G))...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -160,8 +306,9 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -176,17 +323,101 @@ int main()
       hashed_non_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_multiset<unsigned int>        container_t4;
+
+  bench::session s(
+    "non_unique_scattered_lookup",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      scattered_successful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered successful lookup",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      1.0,5
+    );
+
+    test_latency<
+      scattered_unsuccessful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered unsuccessful lookup",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      1.0,5
+    );
+
+    test_latency<
+      scattered_successful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered successful lookup",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      5.0,5
+    );
+
+    test_latency<
+      scattered_unsuccessful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered unsuccessful lookup",
+      {
+        "std::unordered_multiset",
+        "boost::unordered_multiset",
+        "multi_index::hashed_non_unique",
+        "flat_hash_multiset"
+      },
+      5.0,5
+    );
+    return 0;
+  }
 
   test<
     scattered_successful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered successful lookup",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     1.0,5
   );
 
@@ -194,12 +425,17 @@ int main()
     scattered_unsuccessful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered unsuccessful lookup",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     1.0,5
   );
 
@@ -207,12 +443,17 @@ int main()
     scattered_successful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered successful lookup",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     5.0,5
   );
 
@@ -220,12 +461,45 @@ int main()
     scattered_unsuccessful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered unsuccessful lookup",
-    "std::unordered_multiset",
-    "boost::unordered_multiset",
-    "multi_index::hashed_non_unique",
+    {
+      "std::unordered_multiset",
+      "boost::unordered_multiset",
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
     5.0,5
   );
+
+  test_batch<
+    batch_successful_lookup,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Batch successful lookup",
+    {
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    1.0,5
+  );
+
+  test_batch<
+    batch_unsuccessful_lookup,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Batch unsuccessful lookup",
+    {
+      "multi_index::hashed_non_unique",
+      "flat_hash_multiset"
+    },
+    1.0,5
+  );
 }
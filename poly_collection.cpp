@@ -179,6 +179,7 @@ private:
 
 #include <functional>
 #include <iostream>
+#include "bench.hpp"
 
 struct base
 {
@@ -282,25 +283,21 @@ double measure_test(unsigned int n)
   Collection c;
   fill(c,n);
   c.shuffle();
-  double t=measure(std::bind(Tester<Collection>(),std::cref(c)));
-  return (t/n)*10E6;
+  return measure(std::bind(Tester<Collection>(),std::cref(c)))/n;
 }
 
-int main()
+int main(int argc,char* argv[])
 {
   typedef vector_ptr<base>      collection_t1;
   typedef poly_collection<base> collection_t2;
   
-  unsigned int n0=1000,n1=11000000,dn=1000;
-  double       fdn=1.1;
+  bench::session s("poly_collection",argc,argv,{1000,11000000,1000,1.1});
   
-  std::cout<<"for_each:"<<std::endl;
-  std::cout<<"vector_ptr;poly_collection"<<std::endl;
-  
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    std::cout<<
-      n<<";"<<
-      measure_test<run_for_each,collection_t1>(n)<<";"<<
-      measure_test<run_for_each,collection_t2>(n)<<std::endl;
-  }
+  s.run(
+    "for_each",
+    {"vector_ptr","poly_collection"},
+    {
+      &measure_test<run_for_each,collection_t1>,
+      &measure_test<run_for_each,collection_t2>
+    });
 }
@@ -286,6 +286,7 @@ private:
 
 #include <functional>
 #include <iostream>
+#include "bench.hpp"
 
 struct base
 {
@@ -418,11 +419,10 @@ double measure_test(unsigned int n)
   Collection         c;
   Filler<Collection> fill;
   fill(c,n);
-  double t=measure(std::bind(Tester<Collection>(),std::cref(c)));
-  return (t/n)*10E6;
+  return measure(std::bind(Tester<Collection>(),std::cref(c)))/n;
 }
 
-int main()
+int main(int argc,char* argv[])
 {
   typedef poly_collection<base> collection_t1;
   typedef poly_collection<
@@ -445,33 +445,40 @@ int main()
     final_derived2,
     final_derived3>             collection_t7;
 
-  static unsigned int ns[]={1000,10000,100000,10000000};
-
-  std::cout<<"pc<b>;pc<b,d1>;pc<b,d1,d2>;pc<b,d1,d2,d3>"
-             "pc<b,fd1>;pc<b,fd1,fd2>;pc<b,fd1,fd2,fd3>"<<std::endl;
-  std::cout<<"for_each:"<<std::endl;
-  for(auto n:ns){
-    std::cout<<
-      n<<";"<<
-      measure_test<run_for_each,fill_derived,collection_t1>(n)<<";"<<
-      measure_test<run_for_each,fill_derived,collection_t2>(n)<<";"<<
-      measure_test<run_for_each,fill_derived,collection_t3>(n)<<";"<<
-      measure_test<run_for_each,fill_derived,collection_t4>(n)<<";"<<
-      measure_test<run_for_each,fill_final_derived,collection_t5>(n)<<";"<<
-      measure_test<run_for_each,fill_final_derived,collection_t6>(n)<<";"<<
-      measure_test<run_for_each,fill_final_derived,collection_t7>(n)<<std::endl;
-  }
+  bench::session s(
+    "poly_collection2",argc,argv,
+    bench::size_range(
+      std::vector<unsigned int>{1000,10000,100000,10000000}));
 
-  std::cout<<"poly_for_each:"<<std::endl;
-  for(auto n:ns){
-    std::cout<<
-      n<<";"<<
-      measure_test<run_poly_for_each,fill_derived,collection_t1>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_derived,collection_t2>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_derived,collection_t3>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_derived,collection_t4>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_final_derived,collection_t5>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_final_derived,collection_t6>(n)<<";"<<
-      measure_test<run_poly_for_each,fill_final_derived,collection_t7>(n)<<std::endl;
-  }
+  s.run(
+    "for_each",
+    {
+      "pc<b>","pc<b,d1>","pc<b,d1,d2>","pc<b,d1,d2,d3>",
+      "pc<b,fd1>","pc<b,fd1,fd2>","pc<b,fd1,fd2,fd3>"
+    },
+    {
+      &measure_test<run_for_each,fill_derived,collection_t1>,
+      &measure_test<run_for_each,fill_derived,collection_t2>,
+      &measure_test<run_for_each,fill_derived,collection_t3>,
+      &measure_test<run_for_each,fill_derived,collection_t4>,
+      &measure_test<run_for_each,fill_final_derived,collection_t5>,
+      &measure_test<run_for_each,fill_final_derived,collection_t6>,
+      &measure_test<run_for_each,fill_final_derived,collection_t7>
+    });
+
+  s.run(
+    "poly_for_each",
+    {
+      "pc<b>","pc<b,d1>","pc<b,d1,d2>","pc<b,d1,d2,d3>",
+      "pc<b,fd1>","pc<b,fd1,fd2>","pc<b,fd1,fd2,fd3>"
+    },
+    {
+      &measure_test<run_poly_for_each,fill_derived,collection_t1>,
+      &measure_test<run_poly_for_each,fill_derived,collection_t2>,
+      &measure_test<run_poly_for_each,fill_derived,collection_t3>,
+      &measure_test<run_poly_for_each,fill_derived,collection_t4>,
+      &measure_test<run_poly_for_each,fill_final_derived,collection_t5>,
+      &measure_test<run_poly_for_each,fill_final_derived,collection_t6>,
+      &measure_test<run_poly_for_each,fill_final_derived,collection_t7>
+    });
 }
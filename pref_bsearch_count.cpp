@@ -1,4 +1,6 @@
 /* Optimized lexicographical comparison for binary search algorithms.
+ * Requires C++14 (heterogeneous std::set::lower_bound), e.g.
+ *   g++ -std=c++14 -O2 pref_bsearch_count.cpp
  *
  * Copyright 2014 Joaquin M Lopez Munoz.
  * Distributed under the Boost Software License, Version 1.0.
@@ -12,118 +14,175 @@
 #include <string>
 #include <vector>
 
-template<typename Comp,typename Value>
-struct comp_binder
+/* Element type counting its comparisons in a thread-local tally, so that
+ * element comparisons are accounted for whichever comparator or algorithm
+ * performs them. Lexicographical comparators examine each position with ==
+ * and only resolve a mismatch found with <, so just == is counted: the
+ * tally is the number of positions examined, the mismatching one included.
+ */
+
+inline unsigned long& element_comparisons()
+{
+  static thread_local unsigned long n=0;
+  return n;
+}
+
+template<typename T>
+struct counted
 {
-  comp_binder(const Comp& cmp,const Value& x):cmp(cmp),x(x){}
+  counted(T v=T()):v(v){}
 
-  bool less(const Value& y){return cmp(y,x);}
-  bool greater(const Value& y){return cmp(x,y);}
+  friend bool operator==(const counted& x,const counted& y)
+  {
+    ++element_comparisons();
+    return x.v==y.v;
+  }
 
-  const Comp&  cmp;
-  const Value& x;
+  friend bool operator<(const counted& x,const counted& y)
+  {
+    return x.v<y.v;
+  }
+
+  T v;
 };
 
-template<typename Comp,typename Value>
-comp_binder<Comp,Value> comp_bind(const Comp& cmp,const Value& x)
-{
-  return comp_binder<Comp,Value>(cmp,x);
-}
+typedef std::vector<counted<char>> counted_string;
+
+/* Counters of comparator calls and of the element comparisons made since
+ * the last reset, one set per Tag and thread so that measurements in
+ * different threads do not mix.
+ */
 
-struct instrumented_less_string
+template<typename Tag>
+struct comparison_counters
 {
-  static unsigned int call_count,comp_count;
+  static thread_local unsigned long call_count,comp_base;
 
   static void reset()
   {
-    call_count=comp_count=0;
+    call_count=0;
+    comp_base=element_comparisons();
   }
 
-  bool operator()(const std::string& x,const std::string& y)const
+  static unsigned long comp_count()
   {
-    ++call_count;
-    std::string::size_type m=std::min(x.size(),y.size());
-    for(std::string::size_type n=0;n!=m;++n){
-      ++comp_count;
-      if(x[n]<y[n])return true;
-      if(y[n]<x[n])return false;
-    }
-    ++comp_count;
-    return x.size()<y.size();
+    return element_comparisons()-comp_base;
+  }
+
+  static double comps_per_call()
+  {
+    return call_count?double(comp_count())/call_count:0.0;
+  }
+
+  static double calls_per(unsigned long n)
+  {
+    return n?double(call_count)/n:0.0;
   }
 };
-unsigned int instrumented_less_string::call_count=0;
-unsigned int instrumented_less_string::comp_count=0;
+template<typename Tag>
+thread_local unsigned long comparison_counters<Tag>::call_count=0;
+template<typename Tag>
+thread_local unsigned long comparison_counters<Tag>::comp_base=0;
 
-template<typename T>
-struct instrumented_prefix_less:std::less<T>
+/* Comparator adaptor counting the calls to the wrapped Compare, a drop-in
+ * replacement for it in std::set, flat_set, Boost.MultiIndex ordered
+ * indices etc. Calls are forwarded with any argument types, so wrapped
+ * comparators accepting heterogeneous lookup keys keep working.
+ */
+
+template<typename Compare,typename Tag=Compare>
+struct instrumented:Compare,comparison_counters<Tag>
 {
-  static unsigned int call_count,comp_count;
+  typedef comparison_counters<Tag> counters;
+  typedef void                     is_transparent;
 
-  static void reset()
+  instrumented(const Compare& comp=Compare()):Compare(comp){}
+
+  template<typename T,typename Q>
+  bool operator()(const T& x,const Q& y)const
   {
-    call_count=comp_count=0;
+    ++counters::call_count;
+    return Compare::operator()(x,y);
   }
 };
+
+/* Plain lexicographical less. search_key is the type lookups are done
+ * with: the element itself here.
+ */
+
 template<typename T>
-unsigned int instrumented_prefix_less<T>::call_count=0;
+struct lexicographical_less
+{
+  typedef const T& search_key;
+
+  bool operator()(const T& x,const T& y)const
+  {
+    typename T::size_type n=0,m=std::min(x.size(),y.size());
+    while(n!=m&&x[n]==y[n])++n;
+    return n!=m?x[n]<y[n]:n<y.size();
+  }
+};
+
+/* Lexicographical less skipping known common prefixes. During a binary
+ * search every element compared lies between the current lower and upper
+ * bounds, so it shares with the searched value at least the shorter of the
+ * common prefixes of the value and the bounds, which need not be compared
+ * again. The lookup key carries these prefix lengths; it must be fresh for
+ * each search, and the search must be a lower_bound style narrowing, as is
+ * the case for all the containers measured.
+ */
+
 template<typename T>
-unsigned int instrumented_prefix_less<T>::comp_count=0;
+struct prefix_key
+{
+  prefix_key(const T& x):x(x),pref_left(0),pref_right(0){}
+
+  const T&                      x;
+  mutable typename T::size_type pref_left,pref_right;
+};
 
 template<typename T>
-struct comp_binder<instrumented_prefix_less<T>,T>
+struct prefix_less:lexicographical_less<T>
 {
-  typedef instrumented_prefix_less<T> less_type;
+  typedef prefix_key<T> search_key;
+
+  using lexicographical_less<T>::operator();
 
-  comp_binder(const less_type&,const T& x):
-    x(x),x_size(x.size()),x_begin(x.begin()),pref_left(0),pref_right(0)
-  {}
+  /* y<k.x */
 
-  bool less(const T& y)
+  bool operator()(const T& y,const prefix_key<T>& k)const
   {
-    ++less_type::call_count;
-    auto n=std::min(pref_left,pref_right);
-    auto m=std::min(x_size,y.size());
-    auto it1=x_begin+n,it2=y.begin()+n;
-    for(;n!=m&&*it1==*it2;++n,++it1,++it2){
-      ++less_type::comp_count;
-    }
-    ++less_type::comp_count;
-    return (n!=m?*it2<*it1:n<x_size)?(pref_left=n,true):(pref_right=n,false);
+    auto n=std::min(k.pref_left,k.pref_right);
+    auto m=std::min(k.x.size(),y.size());
+    while(n!=m&&k.x[n]==y[n])++n;
+    return (n!=m?y[n]<k.x[n]:n<k.x.size())?
+      (k.pref_left=n,true):(k.pref_right=n,false);
   }
 
-  bool greater(const T& y)
+  /* k.x<y */
+
+  bool operator()(const prefix_key<T>& k,const T& y)const
   {
-    ++less_type::call_count;
-    auto n=std::min(pref_left,pref_right);
-    auto m=std::min(x_size,y.size());
-    auto it1=x_begin+n,it2=y.begin()+n;
-    for(;n!=m&&*it1==*it2;++n,++it1,++it2){
-      ++less_type::comp_count;
-    }
-    ++less_type::comp_count;
-    return (n!=m?*it1<*it2:n<y.size())?(pref_right=n,true):(pref_left=n,false);
+    auto n=std::min(k.pref_left,k.pref_right);
+    auto m=std::min(k.x.size(),y.size());
+    while(n!=m&&k.x[n]==y[n])++n;
+    return (n!=m?k.x[n]<y[n]:n<y.size())?
+      (k.pref_right=n,true):(k.pref_left=n,false);
   }
-
-  const T &                  x;
-  typename T::size_type      x_size;
-  typename T::const_iterator x_begin;
-  typename T::size_type      pref_left,pref_right;
 };
 
-template<typename ForwardIterator,typename T,typename Compare>
+template<typename ForwardIterator,typename Key,typename Compare>
 ForwardIterator lower_bound(
-  ForwardIterator first,ForwardIterator last,const T& x,Compare comp)
+  ForwardIterator first,ForwardIterator last,const Key& x,Compare comp)
 {
   ForwardIterator it;
   typename std::iterator_traits<ForwardIterator>::difference_type count,step;
   count=std::distance(first,last);
-  auto cbind=comp_bind(comp,x);
   while(count>0){
     it=first;
     step=count/2;
     std::advance(it,step);
-    if(cbind.less(*it)){
+    if(comp(*it,x)){
       first=++it;
       count-=step+1;
     }
@@ -136,8 +195,161 @@ template<typename Less,typename Vector>
 double run_lower_bound(const Vector& v)
 {
   Less::reset();
-  for(const auto& x:v)::lower_bound(v.begin(),v.end(),x,Less());
-  return double(Less::comp_count)/Less::call_count;
+  for(const auto& x:v){
+    typename Less::search_key k(x);
+    ::lower_bound(v.begin(),v.end(),k,Less());
+  }
+  return Less::comps_per_call();
+}
+
+#include <cstddef>
+
+/* number of trailing one bits of n */
+
+inline int trailing_ones(std::size_t n)
+{
+#if defined(__GNUC__)
+  return ~n?__builtin_ctzll(~(unsigned long long)n):(int)(8*sizeof(n));
+#else
+  int res=0;
+  for(;n&1;n>>=1)++res;
+  return res;
+#endif
+}
+
+/* floor(log2(n)), n non-null */
+
+inline int floor_log2(std::size_t n)
+{
+#if defined(__GNUC__)
+  return 63-__builtin_clzll((unsigned long long)n);
+#else
+  int res=0;
+  while(n>>=1)++res;
+  return res;
+#endif
+}
+
+/* Binary search tree in level order (see levelorder_vector.cpp) */
+
+template<typename T,typename Compare=std::less<T>>
+class levelorder_vector
+{
+  typedef std::vector<T> vector;
+  
+public:
+  typedef typename vector::value_type             value_type;
+  typedef typename vector::const_iterator         iterator;
+  typedef typename vector::const_iterator         const_iterator;
+  typedef typename vector::size_type              size_type;
+  typedef Compare                                 key_compare;
+  
+  template<typename InputIterator>
+  levelorder_vector(
+    InputIterator first,InputIterator last,const Compare& comp=Compare()):
+    comp(comp)
+  {
+    vector aux(first,last);
+    std::sort(aux.begin(),aux.end(),comp);
+    size_type n=aux.size();
+    impl.resize(n);
+    auto it=aux.begin();
+    if(n){
+      for(size_type k=leftmost(1,n);k;k=next_in_order(k,n))impl[k-1]=*it++;
+    }
+  }
+  
+  const_iterator begin()const{return impl.begin();}
+  const_iterator end()const{return impl.end();}
+  size_type      size()const{return impl.size();}
+  
+  template<typename Key>
+  const_iterator lower_bound(const Key& x)const
+  {
+    size_type n=impl.size(),i=n,j=0;
+    while(j<n){
+      if(comp(impl[j],x)){
+        j=2*j+2;
+      }
+      else{
+        i=j;
+        j=2*j+1;
+      }
+    }
+    return begin()+i;
+  }
+  
+private:
+  /* leftmost descendant of 1-based node k<=n */
+
+  static size_type leftmost(size_type k,size_type n)
+  {
+    k<<=floor_log2(n)-floor_log2(k);
+    return k<=n?k:k>>1;
+  }
+
+  /* in-order successor of 1-based node k, 0 if none: leftmost node of the
+   * right subtree or, failing that, the parent of the topmost ancestor
+   * reached through right-child links
+   */
+
+  static size_type next_in_order(size_type k,size_type n)
+  {
+    if(2*k+1<=n)return leftmost(2*k+1,n);
+    return k>>(trailing_ones(k)+1);
+  }
+
+  Compare comp;
+  vector  impl;
+};
+
+#include <set>
+#include <boost/container/flat_set.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+/* comparator calls per lookup and element comparisons per call for
+ * lookups of every element
+ */
+
+struct lookup_stats
+{
+  double calls_per_lookup,comps_per_call;
+};
+
+template<typename Container,typename Vector>
+lookup_stats run_container_lower_bound(const Vector& v)
+{
+  typedef typename Container::key_compare less_type;
+
+  Container c(v.begin(),v.end());
+  less_type::reset();
+  for(const auto& x:v){
+    typename less_type::search_key k(x);
+    c.lower_bound(k);
+  }
+  return {less_type::calls_per(v.size()),less_type::comps_per_call()};
+}
+
+std::vector<counted_string> strings(char base,unsigned int l)
+{
+  std::vector<counted_string> v;
+  std::string str(l,'0');
+  for(bool done=false;!done;){
+    v.push_back(counted_string(str.begin(),str.end()));
+    done=true;
+    for(auto it=str.rbegin(),it_end=str.rend();it!=it_end;++it){
+      char& c=*it;
+      if(c<'0'+base-1){
+        ++c;
+        done=false;
+        break;
+      }
+      else c='0';
+    }
+  }
+  return v;
 }
 
 void calculate(char base,unsigned int nmax=2000000)
@@ -146,25 +358,70 @@ void calculate(char base,unsigned int nmax=2000000)
   std::cout<<"length;non-optimized;optimized\n";
 
   for(unsigned int l=1;;++l){
-    std::vector<std::string> v;
-    std::string str(l,'0');
-    for(bool done=false;!done;){
-      v.push_back(str);
-      done=true;
-      for(auto it=str.rbegin(),it_end=str.rend();it!=it_end;++it){
-        char& c=*it;
-        if(c<'0'+base-1){
-          ++c;
-          done=false;
-          break;
-        }
-        else c='0';
-      }
+    std::vector<counted_string> v=strings(base,l);
+
+    std::cout<<l<<";"<<
+      run_lower_bound<instrumented<lexicographical_less<counted_string>>>(v)<<
+      ";"<<
+      run_lower_bound<instrumented<prefix_less<counted_string>>>(v)<<"\n";
+    if(v.size()>=nmax)break;
+  }
+}
+
+template<typename Less>
+struct containers
+{
+  typedef std::set<counted_string,Less>                         set;
+  typedef boost::container::flat_set<counted_string,Less>       flat_set;
+  typedef levelorder_vector<counted_string,Less>                lo_vector;
+  typedef boost::multi_index_container<
+    counted_string,
+    boost::multi_index::indexed_by<
+      boost::multi_index::ordered_unique<
+        boost::multi_index::identity<counted_string>,Less
+      >
+    >
+  >                                                             multi_index;
+};
+
+std::ostream& operator<<(std::ostream& os,const lookup_stats& st)
+{
+  return os<<st.calls_per_lookup<<";"<<st.comps_per_call;
+}
+
+void calculate_containers(char base,unsigned int nmax=2000000)
+{
+  typedef containers<
+    instrumented<lexicographical_less<counted_string>>> plain;
+  typedef containers<
+    instrumented<prefix_less<counted_string>>>          prefix;
+
+  static const char* names[]={
+    "std::set","boost::container::flat_set",
+    "levelorder_vector","multi_index"};
+
+  std::cout<<"base: "<<int(base)<<"\n";
+  std::cout<<"length";
+  for(const char* comp:{"",", prefix"}){
+    for(const char* name:names){
+      std::cout<<";"<<name<<comp<<" calls/lookup;"<<
+        name<<comp<<" comparisons/call";
     }
+  }
+  std::cout<<"\n";
+
+  for(unsigned int l=1;;++l){
+    std::vector<counted_string> v=strings(base,l);
 
     std::cout<<l<<";"<<
-      run_lower_bound<instrumented_less_string>(v)<<";"<<
-      run_lower_bound<instrumented_prefix_less<std::string>>(v)<<"\n";
+      run_container_lower_bound<plain::set>(v)<<";"<<
+      run_container_lower_bound<plain::flat_set>(v)<<";"<<
+      run_container_lower_bound<plain::lo_vector>(v)<<";"<<
+      run_container_lower_bound<plain::multi_index>(v)<<";"<<
+      run_container_lower_bound<prefix::set>(v)<<";"<<
+      run_container_lower_bound<prefix::flat_set>(v)<<";"<<
+      run_container_lower_bound<prefix::lo_vector>(v)<<";"<<
+      run_container_lower_bound<prefix::multi_index>(v)<<"\n";
     if(v.size()>=nmax)break;
   }
 }
@@ -172,4 +429,5 @@ void calculate(char base,unsigned int nmax=2000000)
 int main()
 {
   for(char i=2;i<=10;++i)calculate(i);
-}
\ No newline at end of file
+  for(char i=2;i<=10;++i)calculate_containers(i);
+}
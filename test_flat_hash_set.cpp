@@ -0,0 +1,100 @@
+/* flat_hash_set test suite.
+ *
+ * Copyright 2026 Joaquin M Lopez Munoz.
+ * Distributed under the Boost Software License, Version 1.0.
+ * (See accompanying file LICENSE_1_0.txt or copy at
+ * http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#include <boost/detail/lightweight_test.hpp>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "counting_allocator.hpp"
+#include "flat_hash_set.hpp"
+
+typedef flat_hash_set<
+  unsigned int,boost::hash<unsigned int>,std::equal_to<unsigned int>,
+  counting_allocator<unsigned int>
+>                                                   set_type;
+typedef flat_hash_multiset<unsigned int>            multiset_type;
+
+template<typename Set,typename RefSet>
+bool same_contents(const Set& s,const RefSet& ref)
+{
+  if(s.size()!=ref.size())return false;
+  for(unsigned int x:ref)if(s.count(x)!=ref.count(x))return false;
+  for(unsigned int x:s)if(!ref.count(x))return false;
+  return true;
+}
+
+/* erase/insert mix at constant size right below max load: tombstones are
+ * dropped every so often, not on nearly every insertion
+ */
+
+void test_churn()
+{
+  set_type                  s;
+  std::vector<unsigned int> v;
+  std::mt19937              gen(92301);
+
+  s.reserve(10000);
+  std::size_t capacity=s.bucket_count(),
+              n=std::size_t(capacity*s.max_load_factor())-8;
+  for(unsigned int x=0;v.size()<n;++x){
+    s.insert(x);
+    v.push_back(x);
+  }
+  BOOST_TEST(s.bucket_count()==capacity);
+
+  static const std::size_t num_updates=200000;
+  std::unordered_set<unsigned int> ref(v.begin(),v.end());
+  unsigned int                     next=(unsigned int)n;
+
+  reset_allocation_stats();
+  for(std::size_t i=0;i<num_updates;++i){
+    std::size_t j=std::uniform_int_distribution<std::size_t>(0,n-1)(gen);
+    BOOST_TEST(s.erase(v[j])==1);
+    ref.erase(v[j]);
+    v[j]=next++;
+    BOOST_TEST(s.insert(v[j]).second);
+    ref.insert(v[j]);
+  }
+
+  /* each rehash allocates two arrays */
+
+  std::size_t rehashes=get_allocation_stats().allocations/2;
+  BOOST_TEST(rehashes<=num_updates/(capacity/16));
+  BOOST_TEST(s.bucket_count()<=4*capacity);
+  BOOST_TEST(same_contents(s,ref));
+}
+
+void test_multiset()
+{
+  multiset_type                         s;
+  std::unordered_multiset<unsigned int> ref;
+  std::mt19937                          gen(34862);
+
+  for(int i=0;i<20000;++i){
+    unsigned int x=gen()%5000;
+    if(gen()%4==0){
+      BOOST_TEST(s.erase(x)==ref.erase(x));
+    }
+    else{
+      s.insert(x);
+      ref.insert(x);
+    }
+  }
+  BOOST_TEST(same_contents(s,ref));
+  for(unsigned int x=0;x<5000;++x){
+    auto p=s.equal_range(x);
+    BOOST_TEST((std::size_t)std::distance(p.first,p.second)==ref.count(x));
+  }
+}
+
+int main()
+{
+  test_churn();
+  test_multiset();
+  return boost::report_errors();
+}
@@ -52,13 +52,21 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
 
 struct rand_seq
 {
   rand_seq(unsigned int):gen(34862){}
   unsigned int operator()(){return dist(gen);}
+  void skip(unsigned int m){while(m--)dist(gen);}
 
 private:
   std::uniform_int_distribution<unsigned int> dist;
@@ -112,32 +120,186 @@ struct norehash_running_insertion
   }
 };
 
+/* n insertions split among the threads, each taking its own stretch of
+ * the random sequence. Positioning the sequences and creating the threads
+ * is not timed.
+ */
+
+template<typename Container>
+struct parallel_running_insertion
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(unsigned int n,unsigned int threads)const
+  {
+    unsigned int res=0;
+    {
+      Container s;
+      pause_timing();
+      std::vector<rand_seq> rnds;
+      for(unsigned int t=0;t<threads;++t){
+        rnds.push_back(rand_seq(n));
+        rnds.back().skip((unsigned int)((unsigned long long)n*t/threads));
+      }
+
+      bench::start_gate        gate;
+      std::vector<std::thread> ths;
+      for(unsigned int t=0;t<threads;++t){
+        unsigned int m=(unsigned int)(
+          (unsigned long long)n*(t+1)/threads-
+          (unsigned long long)n*t/threads);
+        ths.emplace_back([&,t,m](){
+          rand_seq& rnd=rnds[t];
+          gate.wait();
+          for(unsigned int i=m;i--;)s.insert(rnd());
+        });
+      }
+      resume_timing();
+      gate.open();
+      for(auto& th:ths)th.join();
+      res=s.size();
+      pause_timing();
+    }
+    resume_timing();
+    return res;
+  }
+};
+
+template<typename Container>
+struct parallel_norehash_running_insertion
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(unsigned int n,unsigned int threads)const
+  {
+    unsigned int res=0;
+    {
+      Container s;
+      reserve(s,n);
+      pause_timing();
+      std::vector<rand_seq> rnds;
+      for(unsigned int t=0;t<threads;++t){
+        rnds.push_back(rand_seq(n));
+        rnds.back().skip((unsigned int)((unsigned long long)n*t/threads));
+      }
+
+      bench::start_gate        gate;
+      std::vector<std::thread> ths;
+      for(unsigned int t=0;t<threads;++t){
+        unsigned int m=(unsigned int)(
+          (unsigned long long)n*(t+1)/threads-
+          (unsigned long long)n*t/threads);
+        ths.emplace_back([&,t,m](){
+          rand_seq& rnd=rnds[t];
+          gate.wait();
+          for(unsigned int i=m;i--;)s.insert(rnd());
+        });
+      }
+      resume_timing();
+      gate.open();
+      for(auto& th:ths)th.join();
+      res=s.size();
+      pause_timing();
+    }
+    resume_timing();
+    return res;
+  }
+};
+
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct running_insertion_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n);
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      s.insert(x);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<typename Container>
+struct norehash_running_insertion_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n);
+    reserve(s,n);
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      s.insert(x);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n)
+{
+  unsigned int m=Tester<Container>()(n);
+  return measure(boost::bind(Tester<Container>(),n))/m;
+}
+
+/* rows are labelled with the number of distinct elements of the first
+ * container, which is less than n as random values repeat
+ */
+
 template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
+  template<typename> class Tester,typename Container,typename... Containers
+>
 void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3)
+  bench::session& s,const char* title,const std::vector<std::string>& names)
 {
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
-
-  std::cout<<title<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  s.run(
+    title,names,
+    {bench::runner(&run<Tester,Container>),
+     bench::runner(&run<Tester,Containers>)...},
+    10E6,[](unsigned int n){return Tester<Container>()(n);});
+}
 
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
-    unsigned int m=Tester<Container1>()(n);
+/* aggregate insertions/s */
 
-    t=measure(boost::bind(Tester<Container1>(),n));
-    std::cout<<m<<";"<<(t/m)*10E6;
+template<template<typename> class Tester,typename Container>
+double run_parallel(unsigned int n,unsigned int threads)
+{
+  unsigned int m=Tester<Container>()(n,threads);
+  return m/measure(boost::bind(Tester<Container>(),n,threads));
+}
 
-    t=measure(boost::bind(Tester<Container2>(),n));
-    std::cout<<";"<<(t/m)*10E6;
- 
-    t=measure(boost::bind(Tester<Container3>(),n));
-    std::cout<<";"<<(t/m)*10E6<<std::endl;
+template<template<typename> class Tester,typename Container>
+void test_parallel(bench::session& s,const char* title,const std::string& name)
+{
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  for(unsigned int t:bench::thread_counts(s.get_options())){
+    columns.push_back(name+" ("+bench::thread_label(t)+")");
+    runners.push_back(
+      std::bind(&run_parallel<Tester,Container>,std::placeholders::_1,t));
   }
+  s.run(title,columns,runners,1.0);
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  latency::test(s,title,names,{latency::runner(Tester<Containers>())...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -145,8 +307,10 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "concurrent_hash_set.hpp"
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -161,28 +325,88 @@ int main()
       hashed_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_set<unsigned int>             container_t4;
+  typedef concurrent_hash_set<unsigned int>       container_t5;
+
+  bench::session s(
+    "unique_running_insertion",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      norehash_running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "No-rehash running insertion",
+      {
+        "std::unordered_set",
+        "boost::unordered_set",
+        "multi_index::hashed_unique",
+        "flat_hash_set"
+      }
+    );
+
+    test_latency<
+      running_insertion_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Running insertion",
+      {
+        "std::unordered_set",
+        "boost::unordered_set",
+        "multi_index::hashed_unique",
+        "flat_hash_set"
+      }
+    );
+    return 0;
+  }
 
   test<
     norehash_running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "No-rehash runnning insertion",
-    "std::unordered_set",
-    "boost::unordered_set",
-    "multi_index::hashed_unique"
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
   );
 
   test<
     running_insertion,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Runnning insertion",
-    "std::unordered_set",
-    "boost::unordered_set",
-    "multi_index::hashed_unique"
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
   );
+
+  test_parallel<parallel_norehash_running_insertion,container_t5>(
+    s,"Parallel no-rehash running insertion (insertions/s)",
+    "concurrent_hash_set");
+
+  test_parallel<parallel_running_insertion,container_t5>(
+    s,"Parallel running insertion (insertions/s)",
+    "concurrent_hash_set");
 }
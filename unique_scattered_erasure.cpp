@@ -52,9 +52,13 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
 #include <iostream>
 #include <random>
+#include <string>
 #include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
 
 struct rand_seq
 {
@@ -94,32 +98,62 @@ struct scattered_erasure
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
-void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3)
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct scattered_erasure_latency
 {
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
+  typedef latency::histogram result_type;
 
-  std::cout<<title<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
+  latency::histogram operator()(unsigned int n)const
+  {
+    latency::histogram h;
+    Container          s;
+    rand_seq           rnd(n);
+    for(unsigned int m=n;m--;)s.insert(rnd());
+    std::vector<typename Container::iterator> v;
+    v.reserve(s.size());
+    for(auto it=s.begin();it!=s.end();++it)v.push_back(it);
+    std::mt19937 gen(73642);
+    std::shuffle(v.begin(),v.end(),gen);
+    for(auto it:v){
+      std::uint64_t t0=latency::start();
+      s.erase(it);
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
 
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
-    unsigned int m=Tester<Container1>()(n);
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n)
+{
+  unsigned int m=Tester<Container>()(n);
+  return measure(boost::bind(Tester<Container>(),n))/m;
+}
 
-    t=measure(boost::bind(Tester<Container1>(),n));
-    std::cout<<m<<";"<<(t/m)*10E6;
+/* rows are labelled with the number of distinct elements of the first
+ * container, which is less than n as random values repeat
+ */
 
-    t=measure(boost::bind(Tester<Container2>(),n));
-    std::cout<<";"<<(t/m)*10E6;
- 
-    t=measure(boost::bind(Tester<Container3>(),n));
-    std::cout<<";"<<(t/m)*10E6<<std::endl;
-  }
+template<
+  template<typename> class Tester,typename Container,typename... Containers
+>
+void test(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  s.run(
+    title,names,
+    {bench::runner(&run<Tester,Container>),
+     bench::runner(&run<Tester,Containers>)...},
+    10E6,[](unsigned int n){return Tester<Container>()(n);});
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  latency::test(s,title,names,{latency::runner(Tester<Containers>())...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -127,8 +161,9 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -143,16 +178,45 @@ int main()
       hashed_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_set<unsigned int>             container_t4;
+
+  bench::session s(
+    "unique_scattered_erasure",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      scattered_erasure_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered erasure",
+      {
+        "std::unordered_set",
+        "boost::unordered_set",
+        "multi_index::hashed_unique",
+        "flat_hash_set"
+      }
+    );
+    return 0;
+  }
 
   test<
     scattered_erasure,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered erasure",
-    "std::unordered_set",
-    "boost::unordered_set",
-    "multi_index::hashed_unique"
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
   );
 }
@@ -22,6 +22,7 @@ double measure(F f)
   static const int              num_trials=10;
   static const milliseconds     min_time_per_trial(200);
   std::array<double,num_trials> trials;
+  static decltype(f())          res; /* to avoid optimizing f() away */
 
   for(int i=0;i<num_trials;++i){
     int                               runs=0;
@@ -29,12 +30,13 @@ double measure(F f)
 
     measure_start=high_resolution_clock::now();
     do{
-      f();
+      res=f();
       ++runs;
       t2=high_resolution_clock::now();
     }while(t2-measure_start<min_time_per_trial);
     trials[i]=duration_cast<duration<double>>(t2-measure_start).count()/runs;
   }
+  (void)res; /* var not used warn */
 
   std::sort(trials.begin(),trials.end());
   return std::accumulate(
@@ -52,14 +54,22 @@ void resume_timing()
 }
 
 #include <boost/bind.hpp>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <random>
+#include <string>
+#include <thread>
 #include <vector>
+#include "bench.hpp"
+#include "latency_histogram.hpp"
+#include "find_batch.hpp"
 
 struct rand_seq
 {
   rand_seq(unsigned int):gen(34862){}
   unsigned int operator()(){return dist(gen);}
+  void skip(unsigned int m){while(m--)dist(gen);}
 
 private:
   std::uniform_int_distribution<unsigned int> dist;
@@ -110,37 +120,267 @@ struct scattered_unsuccessful_lookup
   }
 };
 
-template<
-  template<typename> class Tester,
-  typename Container1,typename Container2,typename Container3>
+/* Concurrent lookups: n lookups split among the threads. For successful
+ * lookups each thread takes its own stretch of the insertion sequence.
+ * Positioning the sequences and creating the threads is not timed.
+ */
+
+template<typename Container>
+struct concurrent_successful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int threads)const
+  {
+    pause_timing();
+    std::vector<rand_seq> rnds;
+    for(unsigned int t=0;t<threads;++t){
+      rnds.push_back(rand_seq(n));
+      rnds.back().skip((unsigned int)((unsigned long long)n*t/threads));
+    }
+
+    bench::start_gate         gate;
+    std::vector<unsigned int> res(threads);
+    std::vector<std::thread>  ths;
+    for(unsigned int t=0;t<threads;++t){
+      unsigned int m=(unsigned int)(
+        (unsigned long long)n*(t+1)/threads-
+        (unsigned long long)n*t/threads);
+      ths.emplace_back([&,t,m](){
+        unsigned int r=0;
+        rand_seq&    rnd=rnds[t];
+        auto         end_=s.end();
+        gate.wait();
+        for(unsigned int i=m;i--;){
+          if(s.find(rnd())!=end_)++r;
+        }
+        res[t]=r;
+      });
+    }
+    resume_timing();
+    gate.open();
+    for(auto& th:ths)th.join();
+    return std::accumulate(res.begin(),res.end(),0u);
+  }
+};
+
+template<typename Container>
+struct concurrent_unsuccessful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int threads)const
+  {
+    pause_timing();
+    bench::start_gate         gate;
+    std::vector<unsigned int> res(threads);
+    std::vector<std::thread>  ths;
+    for(unsigned int t=0;t<threads;++t){
+      unsigned int m=(unsigned int)(
+        (unsigned long long)n*(t+1)/threads-
+        (unsigned long long)n*t/threads);
+      ths.emplace_back([&,t,m](){
+        unsigned int                                r=0;
+        std::uniform_int_distribution<unsigned int> dist;
+        std::mt19937                                gen(76453+t);
+        auto                                        end_=s.end();
+        gate.wait();
+        for(unsigned int i=m;i--;){
+          if(s.find(dist(gen))!=end_)++r;
+        }
+        res[t]=r;
+      });
+    }
+    resume_timing();
+    gate.open();
+    for(auto& th:ths)th.join();
+    return std::accumulate(res.begin(),res.end(),0u);
+  }
+};
+
+/* Lookups in batches of K keys through find_batch. */
+
+template<typename Container>
+struct batch_successful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int K)const
+  {
+    typedef typename Container::const_iterator const_iterator;
+
+    unsigned int                                res=0;
+    rand_seq                                    rnd(n);
+    std::vector<unsigned int>                   keys(K);
+    std::vector<const_iterator>                 its(K);
+    auto                                        end_=s.end();
+    while(n){
+      unsigned int m=std::min(n,K);
+      for(unsigned int i=0;i<m;++i)keys[i]=rnd();
+      find_batch(s,keys.data(),m,its.data());
+      for(unsigned int i=0;i<m;++i)if(its[i]!=end_)++res;
+      n-=m;
+    }
+    return res;
+  }
+};
+
+template<typename Container>
+struct batch_unsuccessful_lookup
+{
+  typedef unsigned int result_type;
+
+  unsigned int operator()(
+    const Container& s,unsigned int n,unsigned int K)const
+  {
+    typedef typename Container::const_iterator const_iterator;
+
+    unsigned int                                res=0;
+    std::uniform_int_distribution<unsigned int> dist;
+    std::mt19937                                gen(76453);
+    std::vector<unsigned int>                   keys(K);
+    std::vector<const_iterator>                 its(K);
+    auto                                        end_=s.end();
+    while(n){
+      unsigned int m=std::min(n,K);
+      for(unsigned int i=0;i<m;++i)keys[i]=dist(gen);
+      find_batch(s,keys.data(),m,its.data());
+      for(unsigned int i=0;i<m;++i)if(its[i]!=end_)++res;
+      n-=m;
+    }
+    return res;
+  }
+};
+
+/* Per-operation latencies, for --mode=latency. */
+
+template<typename Container>
+struct scattered_successful_lookup_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n)const
+  {
+    const Container                             s=create<Container>(n);
+    latency::histogram                          h;
+    volatile unsigned int                       res=0;
+    rand_seq                                    rnd(n);
+    auto                                        end_=s.end();
+    while(n--){
+      unsigned int  x=rnd();
+      std::uint64_t t0=latency::start();
+      if(s.find(x)!=end_)res=res+1;
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<typename Container>
+struct scattered_unsuccessful_lookup_latency
+{
+  typedef latency::histogram result_type;
+
+  latency::histogram operator()(unsigned int n)const
+  {
+    const Container                             s=create<Container>(n);
+    latency::histogram                          h;
+    volatile unsigned int                       res=0;
+    std::uniform_int_distribution<unsigned int> dist;
+    std::mt19937                                gen(76453);
+    auto                                        end_=s.end();
+    while(n--){
+      unsigned int  x=dist(gen);
+      std::uint64_t t0=latency::start();
+      if(s.find(x)!=end_)res=res+1;
+      h.record(latency::stop()-t0);
+    }
+    return h;
+  }
+};
+
+template<template<typename> class Tester,typename Container>
+double run(unsigned int n)
+{
+  const Container s=create<Container>(n);
+  return measure(boost::bind(Tester<Container>(),boost::cref(s),n))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
 void test(
-  const char* title,
-  const char* name1,const char* name2,const char* name3)
-{
-  unsigned int n0=10000,n1=3000000,dn=500;
-  double       fdn=1.05;
-
-  std::cout<<title<<":"<<std::endl;
-  std::cout<<name1<<";"<<name2<<";"<<name3<<std::endl;
-
-  for(unsigned int n=n0;n<=n1;n+=dn,dn=(unsigned int)(dn*fdn)){
-    double t;
-
-    t=measure(boost::bind(
-      Tester<Container1>(),
-      boost::cref(create<Container1>(n)),n));
-    std::cout<<n<<";"<<(t/n)*10E6;
-
-    t=measure(boost::bind(
-      Tester<Container2>(),
-      boost::cref(create<Container2>(n)),n));
-    std::cout<<";"<<(t/n)*10E6;
- 
-    t=measure(boost::bind(
-      Tester<Container3>(),
-      boost::cref(create<Container3>(n)),n));
-    std::cout<<";"<<(t/n)*10E6<<std::endl;
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  s.run(title,names,{bench::runner(&run<Tester,Containers>)...});
+}
+
+/* one column per container and batch size */
+
+template<template<typename> class Tester,typename Container>
+double run_batch(unsigned int n,unsigned int K)
+{
+  const Container s=create<Container>(n);
+  return measure(boost::bind(Tester<Container>(),boost::cref(s),n,K))/n;
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_batch(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  typedef std::function<double(unsigned int,unsigned int)> batch_runner;
+
+  static const unsigned int batch_sizes[]={1,2,4,8,16,32,64};
+
+  std::vector<batch_runner> runs={
+    batch_runner(&run_batch<Tester,Containers>)...};
+
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  for(std::size_t i=0;i<names.size();++i){
+    for(unsigned int K:batch_sizes){
+      columns.push_back(names[i]+" (K="+std::to_string(K)+")");
+      runners.push_back(std::bind(runs[i],std::placeholders::_1,K));
+    }
   }
+  s.run(title,columns,runners);
+}
+
+/* aggregate lookups/s */
+
+template<template<typename> class Tester,typename Container>
+double run_concurrent(unsigned int n,unsigned int threads)
+{
+  const Container s=create<Container>(n);
+  return n/measure(boost::bind(Tester<Container>(),boost::cref(s),n,threads));
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_concurrent(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  typedef std::function<double(unsigned int,unsigned int)> concurrent_runner;
+
+  std::vector<concurrent_runner> runs={
+    concurrent_runner(&run_concurrent<Tester,Containers>)...};
+
+  std::vector<std::string>   columns;
+  std::vector<bench::runner> runners;
+  for(std::size_t i=0;i<names.size();++i){
+    for(unsigned int t:bench::thread_counts(s.get_options())){
+      columns.push_back(names[i]+" ("+bench::thread_label(t)+")");
+      runners.push_back(std::bind(runs[i],std::placeholders::_1,t));
+    }
+  }
+  s.run(title,columns,runners,1.0);
+}
+
+template<template<typename> class Tester,typename... Containers>
+void test_latency(
+  bench::session& s,const char* title,const std::vector<std::string>& names)
+{
+  latency::test(s,title,names,{latency::runner(Tester<Containers>())...});
 }
 
 #include <boost/unordered_set.hpp>
@@ -148,8 +388,9 @@ void test(
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <unordered_set>
+#include "flat_hash_set.hpp"
 
-int main()
+int main(int argc,char* argv[])
 {
   using namespace boost::multi_index;
 
@@ -164,28 +405,139 @@ int main()
       hashed_unique<identity<unsigned int> >
     >
   >                                               container_t3;
+  typedef flat_hash_set<unsigned int>             container_t4;
+
+  bench::session s(
+    "unique_scattered_lookup",argc,argv,{10000,3000000,500,1.05});
+
+  if(s.get_options().mode==bench::latency_mode){
+    test_latency<
+      scattered_successful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered successful lookup",
+      {
+        "std::unordered_set",
+        "boost::unordered_set",
+        "multi_index::hashed_unique",
+        "flat_hash_set"
+      }
+    );
+
+    test_latency<
+      scattered_unsuccessful_lookup_latency,
+      container_t1,
+      container_t2,
+      container_t3,
+      container_t4>
+    (
+      s,
+      "Scattered unsuccessful lookup",
+      {
+        "std::unordered_set",
+        "boost::unordered_set",
+        "multi_index::hashed_unique",
+        "flat_hash_set"
+      }
+    );
+    return 0;
+  }
 
   test<
     scattered_successful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered successful lookup",
-    "std::unordered_set",
-    "boost::unordered_set",
-    "multi_index::hashed_unique"
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
   );
 
   test<
     scattered_unsuccessful_lookup,
     container_t1,
     container_t2,
-    container_t3>
+    container_t3,
+    container_t4>
   (
+    s,
     "Scattered unsuccessful lookup",
-    "std::unordered_set",
-    "boost::unordered_set",
-    "multi_index::hashed_unique"
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
+  );
+
+  test_concurrent<
+    concurrent_successful_lookup,
+    container_t1,
+    container_t2,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Concurrent scattered successful lookup (lookups/s)",
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
+  );
+
+  test_concurrent<
+    concurrent_unsuccessful_lookup,
+    container_t1,
+    container_t2,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Concurrent scattered unsuccessful lookup (lookups/s)",
+    {
+      "std::unordered_set",
+      "boost::unordered_set",
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
+  );
+
+  test_batch<
+    batch_successful_lookup,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Batch successful lookup",
+    {
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
+  );
+
+  test_batch<
+    batch_unsuccessful_lookup,
+    container_t3,
+    container_t4>
+  (
+    s,
+    "Batch unsuccessful lookup",
+    {
+      "multi_index::hashed_unique",
+      "flat_hash_set"
+    }
   );
 }